@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include "ubitx.h"
+
+/**
+ * The frequency as packed BCD: eight decimal digits in 32 bits, four bits each,
+ * the 10 MHz digit on top and the Hz digit at the bottom. 14.285 MHz is 0x14285000.
+ *
+ * The display wants the frequency as digits and the CAT protocol as BCD nibbles. Getting
+ * them from a binary number takes a division by ten for each digit, and the AVR has no
+ * divide instruction, each one is a loop of some 600 cycles. Here nothing is divided:
+ * a new frequency is converted by shifting (double dabble), and a tuning step, which
+ * is a few hundred Hz, is converted the same way and added to the last value digit by digit.
+ *
+ * Only the last frequency that setFrequency() tuned to is kept. Eight digits are enough
+ * for everything up to 99.999999 MHz.
+ */
+
+static uint32_t bcdFreq = 0;         //the frequency last tuned to, in BCD
+static uint32_t bcdBinary = 0;  //and the same in binary
+
+//double dabble: the bits are shifted in from the top of n, before each shift every
+//digit of 5 or more has 3 added to it so that doubling it carries into the next digit
+uint32_t bcdFromBinary(uint32_t n) {
+  uint32_t bcd = 0;
+  byte bits = 32;
+
+  //small numbers, like the tuning steps, don't need all the 32 rounds
+  while (bits && !(n & 0x80000000l)) {
+    n <<= 1;
+    bits--;
+  }
+
+  while (bits--) {
+    //all the digits are adjusted at once, a digit can't carry into its neighbour here
+    uint32_t fives = (bcd + 0x33333333l) & 0x88888888l;
+    bcd += (fives >> 2) + (fives >> 3);
+    bcd = (bcd << 1) | (n >> 31);
+    n <<= 1;
+  }
+  return bcd;
+}
+
+uint32_t bcdAdd(uint32_t a, uint32_t b) {
+  uint32_t sum = 0;
+  byte carry = 0;
+
+  for (byte i = 0; i < 8; i++) {
+    byte digit = (a & 0xf) + (b & 0xf) + carry;
+    carry = digit > 9;
+    if (carry)
+      digit -= 10;
+    sum = (sum >> 4) | ((uint32_t)digit << 28);
+    a >>= 4;
+    b >>= 4;
+  }
+  return sum;
+}
+
+uint32_t bcdSubtract(uint32_t a, uint32_t b) {
+  uint32_t difference = 0;
+  byte borrow = 0;
+
+  for (byte i = 0; i < 8; i++) {
+    int8_t digit = (a & 0xf) - (b & 0xf) - borrow;
+    borrow = digit < 0;
+    if (borrow)
+      digit += 10;
+    difference = (difference >> 4) | ((uint32_t)digit << 28);
+    a >>= 4;
+    b >>= 4;
+  }
+  return difference;
+}
+
+//called by setFrequency(), steps the BCD copy along with the radio
+void bcdTune(uint32_t f) {
+  if (f > bcdBinary && f - bcdBinary < 0x10000l)
+    bcdFreq = bcdAdd(bcdFreq, bcdFromBinary(f - bcdBinary));
+  else if (f < bcdBinary && bcdBinary - f < 0x10000l)
+    bcdFreq = bcdSubtract(bcdFreq, bcdFromBinary(bcdBinary - f));
+  else if (f != bcdBinary)
+    bcdFreq = bcdFromBinary(f);
+  bcdBinary = f;
+}
+
+uint32_t bcdFrequency(uint32_t f) {
+  if (f == bcdBinary)
+    return bcdFreq;
+  return bcdFromBinary(f);
+}
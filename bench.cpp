@@ -0,0 +1,219 @@
+#include <Arduino.h>
+#include "ubitx.h"
+#include "nano_gui.h"
+#include "scratch.h"
+
+/**
+ * Times the routines that run most often, on the radio itself. Set BENCHMARKS to 1 in
+ * ubitx.h and each one is run up to a few hundred times at power up, with the same kind of
+ * input the radio gives it. Every call is timed on its own with timerCycles(), and the
+ * average, the best and the worst case are printed on the serial port at 38400 baud, in
+ * clock cycles (62.5 nsec each at 16 MHz):
+ *
+ *   formatFreq: 984 avg, 976 min, 1016 max
+ *
+ * The worst case is what matters for the keyer and CAT, it is how long they can be held up.
+ * The counts are good to 8 cycles. The cost of the stopwatch and of calling through the
+ * table is measured first and taken off the others.
+ * Nothing in the sketch allocates from the heap, what the scratch arena gave out is
+ * checked instead: a lease that didn't fit is counted and printed at the end.
+ *
+ * Some of these talk to the hardware: the oscillators are retuned and a character is
+ * drawn in the top left corner of the screen. setup() paints the screen and tunes the
+ * radio again after the benchmarks.
+ *
+ * The cycles are only had from a Nano. The host build runs the same table in
+ * host/harness/bench.cpp, in nsec on the host's clock and with the allocations counted.
+ */
+#if BENCHMARKS
+
+static uint32_t benchFreq = 7285000l;
+static byte benchCat[5];
+static struct Point benchPoint;
+static volatile int16_t benchSamples[3] = {1850, 1874, 1862};
+
+static void benchEmpty() {
+}
+
+static void benchSetfreq() {
+  si5351bx_setfreq(2, firstIF + benchFreq);
+}
+
+//a knob step, both oscillators and the filters
+static void benchSetFrequency() {
+  setFrequency(frequency + 50);
+}
+
+//one digit of the vfo changes
+static void benchDisplayVFO() {
+  frequency += 50;
+  displayVFO(vfoActive);
+}
+
+static void benchGuiUpdate() {
+  guiUpdate();
+}
+
+//the CAT poll with nothing waiting, which is what it does most of the time
+static void benchCheckCAT() {
+  checkCAT();
+}
+
+static void benchFormatTuned() {
+  Scratch<10> text;
+  formatFreq(frequency, text);
+}
+
+//a frequency the radio isn't tuned to has to be converted to BCD first
+static void benchFormatOther() {
+  Scratch<10> text;
+  formatFreq(frequency + 1000, text);
+}
+
+static void benchBcdTune() {
+  //a knob step up and back down, as when tuning
+  bcdTune(frequency + 50);
+  bcdTune(frequency);
+}
+
+static void benchWriteFreq() {
+  writeFreq(benchFreq, benchCat);
+}
+
+static void benchReadFreq() {
+  readFreq(benchCat);
+}
+
+static void benchDisplayChar() {
+  displayChar(0, TEXT_LINE_HEIGHT, '8', DISPLAY_WHITE, DISPLAY_NAVY);
+}
+
+static void benchFillrect() {
+  displayFillrect(0, 0, 30, 30, DISPLAY_NAVY);
+}
+
+static void benchScaleTouch() {
+  benchPoint.x = 2000;
+  benchPoint.y = 1800;
+  scaleTouch(&benchPoint);
+}
+
+//the pen is up most of the time, then the controller is read on every pass of loop()
+static void benchReadTouch() {
+  readTouch();
+}
+
+//what a touch costs on top, the three samples of each axis are averaged
+static void benchBestTwoAvg() {
+  touch_besttwoavg(benchSamples[0], benchSamples[1], benchSamples[2]);
+}
+
+static void benchEncRead() {
+  enc_read();
+}
+
+//the pin change interrupt of the knob, for an edge that steps and one that doesn't
+static void benchEncStep() {
+  enc_edge_bench(true);
+}
+
+static void benchEncIdle() {
+  enc_edge_bench(false);
+}
+
+static void benchPaddleLatch() {
+  update_PaddleLatch(0);
+}
+
+struct Bench {
+  char name[16];
+  void (*run)();
+  unsigned int count;
+};
+
+const struct Bench benches[] PROGMEM = {
+  {"empty", benchEmpty, 1000},
+  {"setfreq", benchSetfreq, 100},
+  {"setFrequency", benchSetFrequency, 100},
+  {"displayVFO", benchDisplayVFO, 100},
+  {"guiUpdate", benchGuiUpdate, 3},
+  {"checkCAT", benchCheckCAT, 1000},
+  {"formatFreq", benchFormatTuned, 500},
+  {"formatFreq new", benchFormatOther, 500},
+  {"bcdTune", benchBcdTune, 500},
+  {"writeFreq", benchWriteFreq, 1000},
+  {"readFreq", benchReadFreq, 1000},
+  {"displayChar", benchDisplayChar, 100},
+  {"fillrect 30x30", benchFillrect, 20},
+  {"readTouch", benchReadTouch, 100},
+  {"touch avg", benchBestTwoAvg, 1000},
+  {"scaleTouch", benchScaleTouch, 500},
+  {"enc_read", benchEncRead, 1000},
+  {"enc isr step", benchEncStep, 1000},
+  {"enc isr idle", benchEncIdle, 1000},
+  {"paddle latch", benchPaddleLatch, 100},
+};
+#define MAX_BENCHES (int)(sizeof(benches) / sizeof(struct Bench))
+
+void runBenchmarks() {
+  uint32_t overhead = 0;
+  uint32_t tuned = frequency;
+  byte overflows = scratchOverflows;
+
+  for (int i = 0; i < MAX_BENCHES; i++) {
+    struct Bench bench;
+    uint32_t total = 0, least = 0xffffffffl, most = 0;
+    memcpy_P(&bench, benches + i, sizeof(struct Bench));
+
+    for (unsigned int n = 0; n < bench.count; n++) {
+      uint32_t start = timerCycles();
+      bench.run();
+      uint32_t elapsed = timerCycles() - start;
+      //the counts are good to 8 cycles, a quick one can come out under the overhead
+      uint32_t cycles = elapsed > overhead ? elapsed - overhead : 0;
+
+      total += cycles;
+      if (cycles < least)
+        least = cycles;
+      if (cycles > most)
+        most = cycles;
+    }
+
+    //the first one is the empty call, its best time is taken off the rest
+    if (i == 0)
+      overhead = least;
+
+    Serial.print(bench.name);
+    Serial.print(F(": "));
+    Serial.print(total / bench.count);
+    Serial.print(F(" avg, "));
+    Serial.print(least);
+    Serial.print(F(" min, "));
+    Serial.print(most);
+    Serial.println(F(" max"));
+    Serial.flush();
+  }
+
+  Serial.print(F("scratch overflows: "));
+  Serial.println(scratchOverflows - overflows);
+
+  //some of them retune, setup() sets the radio back on this
+  frequency = tuned;
+}
+
+#ifdef UBITX_HOST
+//the same routines for host/harness/bench.cpp, which times them with the host's clock
+int benchCount() {
+  return MAX_BENCHES;
+}
+
+const char *benchName(int i) {
+  return benches[i].name;
+}
+
+void benchCall(int i) {
+  benches[i].run();
+}
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+/**
+ * What goes into a build. The Nano is always short of flash and RAM, so the parts of the
+ * firmware that a station doesn't use can be left out when compiling instead of being
+ * switched off at run time.
+ *
+ * Pick one of the profiles below, or leave UBITX_PROFILE undefined and set the
+ * FEATURE_ switches yourself. A switch set to 0 takes its buttons, its code and its
+ * tables out of the image. tools/build_profiles.sh builds each profile and prints
+ * what it costs in flash and RAM.
+ */
+#define PROFILE_FULL      1   // everything this firmware does, as shipped
+#define PROFILE_RIT       2   // the full build with the RIT button brought back
+#define PROFILE_MINIMAL   3   // a plain ssb/cw radio: no CAT, no iambic keyer, no extra buttons
+
+#ifndef UBITX_PROFILE
+#define UBITX_PROFILE PROFILE_FULL
+#endif
+
+//set to 1 to have the compiler print the profile and the switches it built with
+#ifndef PROFILE_VERBOSE
+#define PROFILE_VERBOSE 0
+#endif
+
+#if UBITX_PROFILE == PROFILE_FULL
+#define FEATURE_RIT         0
+#define FEATURE_IAMBIC      1
+#define FEATURE_CAT         1
+#define FEATURE_BAND_SELECT 1
+#define FEATURE_UI_EXTRAS   1
+#elif UBITX_PROFILE == PROFILE_RIT
+#define FEATURE_RIT         1
+#define FEATURE_IAMBIC      1
+#define FEATURE_CAT         1
+#define FEATURE_BAND_SELECT 1
+#define FEATURE_UI_EXTRAS   1
+#elif UBITX_PROFILE == PROFILE_MINIMAL
+#define FEATURE_RIT         0
+#define FEATURE_IAMBIC      0
+#define FEATURE_CAT         0
+#define FEATURE_BAND_SELECT 0
+#define FEATURE_UI_EXTRAS   0
+#endif
+
+/**
+ * FEATURE_RIT          the RIT button, the tx frequency is held while the knob moves the rx
+ * FEATURE_IAMBIC       the iambic A and B keyer, without it the paddle works as a straight key
+ * FEATURE_CAT          the FT-817 CAT protocol on the USB serial port, the only one we speak
+ * FEATURE_BAND_SELECT  the BND button and the band plan in freq_set
+ * FEATURE_UI_EXTRAS    the A>I, 1Kz, SAV and RCL buttons
+ */
+
+#endif
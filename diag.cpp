@@ -0,0 +1,437 @@
+#include <Arduino.h>
+#include "ubitx.h"
+#include "scratch.h"
+
+/**
+ * How long the parts of loop() take on the radio, in the field.
+ *
+ * Set DIAG_HISTOGRAMS to 1 in ubitx.h and loop() times each of its stages with
+ * timerCycles(). The times are sorted into bins by powers of two: the first bin counts
+ * the runs under 16 usec, the next those under 32 usec and so on, the last bin takes
+ * everything from 4 msec up. A bin stops counting at 65535.
+ *
+ * They are read over the CAT port with two commands of our own, outside the FT-817 set:
+ *
+ *   00 00 00 00 D0  stage in the first byte, answers with its DIAG_BINS counts,
+ *                   two bytes each, low byte first
+ *   00 00 00 00 D1  clears all the counts, and the other counts below, answers 00
+ *
+ * The stages are numbered as DIAG_LOOP and the rest in ubitx.h. With DIAG_HISTOGRAMS at 0
+ * none of this is compiled and loop() is not timed.
+ *
+ * The last two are not stages but how long the radio takes to follow the knob: from the
+ * first step the encoder interrupt sees to the oscillators being retuned (DIAG_KNOB_RIG), and
+ * to the new frequency being drawn (DIAG_KNOB_LCD), which doTuning() holds back to twice a
+ * second. They are counted in units of 256 cycles, so their bins go from under 4 msec up to
+ * a second and more. The median and the 99th percentile can be read off the counts, to the bin.
+ */
+#if DIAG_HISTOGRAMS
+
+static uint16_t diagBins[DIAG_STAGES][DIAG_BINS];
+
+void diagRecord(byte stage, uint32_t cycles) {
+  uint32_t limit = 16 * (F_CPU / 1000000l); //16 usec
+  byte bin = 0;
+
+  while (bin < DIAG_BINS - 1 && cycles >= limit) {
+    limit <<= 1;
+    bin++;
+  }
+  if (diagBins[stage][bin] != 0xffff)
+    diagBins[stage][bin]++;
+}
+
+uint32_t diagLapTime(byte stage, uint32_t since) {
+  uint32_t now = timerCycles();
+  diagRecord(stage, now - since);
+  return now;
+}
+
+static uint32_t knobShowing;  //the first step that is not on the screen yet
+static bool knobWaiting = false;
+
+//doTuning() has retuned for the steps that began at stepAt
+void diagKnobTuned(uint32_t stepAt) {
+  diagRecord(DIAG_KNOB_RIG, (timerCycles() - stepAt) / 256);
+  if (!knobWaiting) {
+    knobShowing = stepAt;
+    knobWaiting = true;
+  }
+}
+
+//and drawn the frequency
+void diagKnobShown() {
+  if (!knobWaiting)
+    return;
+  diagRecord(DIAG_KNOB_LCD, (timerCycles() - knobShowing) / 256);
+  knobWaiting = false;
+}
+
+//the reply to the CAT command, an unknown stage is answered like an unknown command
+void diagSend(byte stage) {
+  if (stage < DIAG_STAGES)
+    Serial.write((byte *)diagBins[stage], sizeof(diagBins[stage]));
+  else
+    Serial.write((byte)0);
+}
+
+#endif
+
+/**
+ * What the display, the touch screen and the oscillators cost on their buses.
+ *
+ * Set DIAG_BUS to 1 in ubitx.h and the code that talks to them is counted by where it is
+ * called from: the BUS_ sites in ubitx.h. A site counts the bytes it moves, the times it is
+ * entered, the chip selects it pulls down, the clock cycles spent inside it and the pixels
+ * it writes to the display. The SPI sites are the display and the touch screen, BUS_SI5351
+ * is the I2C bus. A site inside another, like utftAddress() in quickFill(), has its bytes
+ * and time counted on its own and not in the outer one. Anything outside a site is counted as BUS_OTHER, without the time.
+ *
+ *   00 00 00 00 D3  the site in the first byte, answers with its bytes (4), entries (2),
+ *                   selects (2), cycles (4) and pixels (4), low byte first
+ *   00 00 00 00 D1  clears these counts with the histograms
+ *
+ * To see what one thing on the screen costs, clear the counts, do it and read them. The pixels
+ * against the 76800 of the screen, or against the area that changed, show how much is drawn
+ * over more than once.
+ */
+#if DIAG_BUS
+
+struct BusStats busStats[BUS_SITES];
+byte busSite = BUS_OTHER;
+static uint32_t busMark;   //when the time of the current site was last counted
+
+byte busSiteEnter(byte site) {
+  uint32_t now = timerCycles();
+  byte outer = busSite;
+
+  if (outer != BUS_OTHER)
+    busStats[outer].cycles += now - busMark;
+  busMark = now;
+  busSite = site;
+  busStats[site].entries++;
+  return outer;
+}
+
+void busSiteLeave(byte outer) {
+  uint32_t now = timerCycles();
+
+  busStats[busSite].cycles += now - busMark;
+  busMark = now;
+  busSite = outer;
+}
+
+void busSend(byte site) {
+  if (site < BUS_SITES)
+    Serial.write((byte *)(busStats + site), sizeof(struct BusStats));
+  else
+    Serial.write((byte)0);
+}
+
+#endif
+
+/**
+ * How late the interrupts start and how long they run, to show that the keyer and the
+ * encoder don't miss anything while CAT and the display are busy.
+ *
+ * Set DIAG_ISR to 1 in ubitx.h and the tick and the encoder interrupts read Timer1 as they
+ * start and as they end. The counter starts over at every tick, so what it reads as the tick
+ * interrupt starts is how late it is: that is the longest the interrupts were held off, by
+ * Serial, tone(), another interrupt or a cli() in the sketch. There is nothing to tell when
+ * the encoder pin changed, its latency is not known and is counted as 0, it is held off by
+ * the same things as the tick. What the encoder does show is the steps it missed: two edges
+ * that came before the interrupt could run for the first, seen as a jump of two states.
+ *
+ *   00 00 00 00 D4  the vector in the first byte, answers with the interrupts counted (4),
+ *                   the sum of their latencies (4) and of their run times (4), the worst
+ *                   latency (2), the longest run (2) and the missed steps (2), low byte first
+ *   00 00 00 00 D1  clears these too
+ *
+ * The times are in Timer1 counts of 8 cycles, half a usec. The averages are the sums divided
+ * by the count. The run times include the reading of the timer, a few counts.
+ */
+#if DIAG_ISR
+
+struct IsrStats isrStats[ISR_VECTORS];
+
+//called at the end of an interrupt, with the interrupts off
+void isrRecord(byte vector, uint16_t start, uint16_t latency) {
+  struct IsrStats *stats = isrStats + vector;
+  uint16_t duration = isrClock() - start;
+
+#ifdef __AVR__
+  //the tick came while it ran and the counter started over
+  if (duration > OCR1A)
+    duration += OCR1A + 1;
+#endif
+  stats->count++;
+  stats->latency += latency;
+  stats->duration += duration;
+  if (latency > stats->latencyMax)
+    stats->latencyMax = latency;
+  if (duration > stats->durationMax)
+    stats->durationMax = duration;
+}
+
+void isrSend(byte vector) {
+  struct IsrStats stats;
+
+  if (vector >= ISR_VECTORS) {
+    Serial.write((byte)0);
+    return;
+  }
+  noInterrupts();
+  stats = isrStats[vector];
+  interrupts();
+  //field by field, the host build pads the struct to 20 bytes
+  Serial.write((byte *)&stats.count, sizeof(stats.count));
+  Serial.write((byte *)&stats.latency, sizeof(stats.latency));
+  Serial.write((byte *)&stats.duration, sizeof(stats.duration));
+  Serial.write((byte *)&stats.latencyMax, sizeof(stats.latencyMax));
+  Serial.write((byte *)&stats.durationMax, sizeof(stats.durationMax));
+  Serial.write((byte *)&stats.missed, sizeof(stats.missed));
+}
+
+#endif
+
+/**
+ * How quickly the CAT commands are answered, and how many are lost, with the programs that
+ * poll the radio: WSJT-X, fldigi and hamlib each have their own pattern and timeouts.
+ *
+ * Set DIAG_CAT_COMMANDS to 1 in ubitx.h and each command is timed from when checkCAT() first
+ * sees a byte of it waiting, to when its reply has been written. That leaves out the time
+ * the bytes take on the wire and in the Serial buffers, up to 2.6 msec for 5 bytes at 38400
+ * baud, and however long loop() took to come round to checkCAT(). The first
+ * CAT_STATS_COMMANDS different commands get a slot each, the rest are only counted as
+ * unlisted. Frames that never arrived in full and were thrown away after CAT_RECEIVE_TIMEOUT
+ * are the timeouts; frames that came in while a command was still running (a dialog
+ * checking CAT) and were thrown away are the dropped ones.
+ *
+ *   00 00 00 00 D6  the slot in the first byte, answers with the timeouts (2), the dropped
+ *                   frames (2), the unlisted commands (2), then for the slot the command (1),
+ *                   how many (2), the sum of their times (4) and the worst time (4), in cycles,
+ *                   low byte first. A slot not used yet has the command 00 and a count of 0.
+ *   00 00 00 00 D1  clears these too
+ */
+#if DIAG_CAT_COMMANDS
+
+static struct CatStats catStats[CAT_STATS_COMMANDS];
+static uint16_t catTimeouts, catDropped, catUnlisted;
+static uint32_t catArrived;  //when the first byte of the frame being read was seen
+static bool catArriving = false;
+
+void catStatsArrived() {
+  if (!catArriving) {
+    catArrived = timerCycles();
+    catArriving = true;
+  }
+}
+
+void catStatsDone(byte command) {
+  uint32_t cycles = timerCycles() - catArrived;
+  struct CatStats *stats = catStats;
+
+  catArriving = false;
+  //the slots are taken in order, the first one free or with this command is it
+  while (stats < catStats + CAT_STATS_COMMANDS && stats->count && stats->command != command)
+    stats++;
+  if (stats == catStats + CAT_STATS_COMMANDS) {
+    catUnlisted++;
+    return;
+  }
+  stats->command = command;
+  stats->count++;
+  stats->cycles += cycles;
+  if (cycles > stats->worst)
+    stats->worst = cycles;
+}
+
+void catStatsTimeout() {
+  catArriving = false;
+  catTimeouts++;
+}
+
+//the frame being timed is the one still running, its clock is left alone
+void catStatsDropped() {
+  catDropped++;
+}
+
+void catStatsSend(byte index) {
+  Serial.write((byte *)&catTimeouts, sizeof(catTimeouts));
+  Serial.write((byte *)&catDropped, sizeof(catDropped));
+  Serial.write((byte *)&catUnlisted, sizeof(catUnlisted));
+  if (index < CAT_STATS_COMMANDS) {
+    Serial.write(catStats[index].command);
+    Serial.write((byte *)&catStats[index].count, sizeof(uint16_t));
+    Serial.write((byte *)&catStats[index].cycles, sizeof(uint32_t));
+    Serial.write((byte *)&catStats[index].worst, sizeof(uint32_t));
+  }
+  else
+    Serial.write((byte)0);
+}
+
+#endif
+
+/**
+ * How close the iambic keyer comes to the timing it is set to, on the air and with whatever
+ * else the radio is doing: the display, CAT, the knob.
+ *
+ * Set DIAG_CW_TIMING to 1 in ubitx.h and the keyer times each dit and dah from the key going
+ * down to it going up again, and each space between them up to the next key down, against
+ * cwSpeed: a dot, three for a dah, one for the space. A space of two dots or more is the
+ * operator pausing, between the characters or the words, and is not counted. The straight
+ * key has nothing to be compared with.
+ *
+ *   00 00 00 00 D7  the kind in the first byte (CW_DIT, CW_DAH or CW_SPACE), answers with how
+ *                   many (2), the sum of their errors (4, signed), the latest (2) and the
+ *                   earliest (2), in usec, low byte first
+ *   00 00 00 00 D1  clears these too
+ *
+ * The keyer timer only runs out on a tick after the deadline, so every element is expected to
+ * be up to a msec too long, and more when loop() is held up.
+ */
+#if DIAG_CW_TIMING
+
+struct CwTiming {
+  uint16_t count;
+  int32_t error;             //the sum, in usec
+  uint16_t late;      //the most too long
+  uint16_t early;     //the most too short
+};
+
+static struct CwTiming cwTiming[CW_KINDS];
+static uint32_t cwMark;    //when the key last went down or up
+static bool cwSpacing = false;  //the key is up between two elements
+
+static void cwTimingRecord(byte kind, uint32_t cycles, unsigned ms) {
+  struct CwTiming *timing = cwTiming + kind;
+  int32_t error = (int32_t)(cycles / (F_CPU / 1000000l)) - ms * 1000l;
+
+  timing->count++;
+  timing->error += error;
+  if (error > (int32_t)timing->late)
+    timing->late = error > 0xffff ? 0xffff : error;
+  if (-error > (int32_t)timing->early)
+    timing->early = -error > 0xffff ? 0xffff : -error;
+}
+
+void cwTimingDown() {
+  uint32_t now = timerCycles();
+  uint32_t cycles = now - cwMark;
+
+  if (cwSpacing && cycles < 2 * (F_CPU / 1000) * cwSpeed)
+    cwTimingRecord(CW_SPACE, cycles, cwSpeed);
+  cwMark = now;
+  cwSpacing = false;
+}
+
+void cwTimingUp(unsigned ms) {
+  uint32_t now = timerCycles();
+
+  cwTimingRecord(ms == (unsigned)cwSpeed ? CW_DIT : CW_DAH, now - cwMark, ms);
+  cwMark = now;
+  cwSpacing = true;
+}
+
+void cwTimingSend(byte kind) {
+  //field by field, the host build pads the struct to 12 bytes
+  if (kind < CW_KINDS) {
+    Serial.write((byte *)&cwTiming[kind].count, sizeof(uint16_t));
+    Serial.write((byte *)&cwTiming[kind].error, sizeof(int32_t));
+    Serial.write((byte *)&cwTiming[kind].late, sizeof(uint16_t));
+    Serial.write((byte *)&cwTiming[kind].early, sizeof(uint16_t));
+  }
+  else
+    Serial.write((byte)0);
+}
+
+#endif
+
+/**
+ * How much RAM the stack has left. The variables take the bottom of the RAM and the stack
+ * grows down from the top, nothing is ever allocated from the heap in between. If the two
+ * meet, the deepest calls (displayChar() with its buffer, inside a dialog, inside a CAT
+ * command) overwrite the variables without a word.
+ *
+ * Set DIAG_STACK to 1 in ubitx.h and setup() starts by filling the free RAM between them with
+ * STACK_PAINT. Whatever has never been written by the stack since still holds it, counting
+ * those bytes up from the variables gives the least room there has been since power up.
+ *
+ *   00 00 00 00 D5  answers with the bytes the stack has never reached (2), the free bytes
+ *                   right now (2) and the scratch leases that did not fit (1), low byte first
+ *
+ * A byte the stack wrote the same value into looks unused, the count can be a few bytes
+ * too high. Built for anything else than the AVR, nothing is painted and the counts are 0.
+ */
+#if DIAG_STACK
+
+#define STACK_PAINT 0xc5
+
+#ifdef __AVR__
+extern char __heap_start;   //the end of the variables, from the linker
+extern char *__brkval;      //the end of the heap, if malloc() was ever called
+
+static char *stackBottom() {
+  return __brkval ? __brkval : &__heap_start;
+}
+#endif
+
+void stackPaint() {
+#ifdef __AVR__
+  char here;
+
+  //leave this frame and its return address alone
+  for (char *p = stackBottom(); p < &here - 8; p++)
+    *p = STACK_PAINT;
+#endif
+}
+
+uint16_t stackUnused() {
+  uint16_t count = 0;
+#ifdef __AVR__
+  char *p = stackBottom();
+  char here;
+
+  while (p + count < &here && p[count] == (char)STACK_PAINT)
+    count++;
+#endif
+  return count;
+}
+
+void stackSend() {
+  uint16_t unused = stackUnused();
+  uint16_t free = 0;
+#ifdef __AVR__
+  char here;
+  free = &here - stackBottom();
+#endif
+
+  Serial.write((byte *)&unused, sizeof(unused));
+  Serial.write((byte *)&free, sizeof(free));
+  Serial.write(scratchOverflows);
+}
+
+#endif
+
+#if DIAG_HISTOGRAMS || DIAG_BUS || DIAG_ISR || DIAG_CAT_COMMANDS || DIAG_CW_TIMING
+void diagReset() {
+#if DIAG_HISTOGRAMS
+  memset(diagBins, 0, sizeof(diagBins));
+#endif
+#if DIAG_BUS
+  memset(busStats, 0, sizeof(busStats));
+#endif
+#if DIAG_ISR
+  noInterrupts();
+  memset(isrStats, 0, sizeof(isrStats));
+  interrupts();
+#endif
+#if DIAG_CAT_COMMANDS
+  memset(catStats, 0, sizeof(catStats));
+  catTimeouts = catDropped = catUnlisted = 0;
+#endif
+#if DIAG_CW_TIMING
+  memset(cwTiming, 0, sizeof(cwTiming));
+#endif
+}
+#endif
@@ -1,33 +1,66 @@
 #include <Arduino.h>
 #include <stdint.h>
 #include "ubitx.h"//Pin definitions
+#include "fastio.h"
 
 //Normal encoder state
 uint8_t prev_enc = 0;
-int8_t enc_count = 0;
+//16 bits, the knob keeps turning while nothing reads it, in a transmit or a dialog, and 8 wrapped
+int16_t enc_count = 0;
 
 //Momentum encoder state
 int16_t enc_count_periodic = 0;
 int8_t momentum[3] = {0};
-static const uint16_t CALLBACK_PERIOD_MS = 200;
+static uint8_t momentum_ticks = 0;
+static const uint8_t CALLBACK_PERIOD_MS = 200;
 static const uint8_t MOMENTUM_MULTIPLIER = 1;
 
+//set by any edge on the encoder, the function button or the PTT, cleared by enc_activity()
+static volatile bool pin_activity = false;
+
+#if DIAG_HISTOGRAMS
+//when the first of the steps not read yet came, in timerCycles()
+static volatile uint32_t enc_step_at = 0;
+#endif
+
+#if DIAG_ISR
+//A in bit 0 and B in bit 1 as last seen, enc_state() folds 3 into 1 and can't show a jump
+static uint8_t enc_raw = 0;
+#endif
+
 uint8_t enc_state (void)
 {
-  return (digitalRead(ENC_A)?1:0 + digitalRead(ENC_B)?2:0);
+  //A wins over B and 3 never comes up, that is how the old ?: expression parsed and the
+  //tuning rate depends on it, don't 'fix' it
+  return (FastPin<ENC_A>::read() ? 1 : FastPin<ENC_B>::read() ? 2 : 0);
 }
 
 /*
  * SmittyHalibut's encoder handling, using interrupts. Should be quicker, smoother handling.
- * The Interrupt Service Routine for Pin Change Interrupts on A0-A5.
+ * What the interrupt does for an edge on the pins, it is inlined into the interrupt below.
  */
-ISR (PCINT1_vect)
+static inline __attribute__((always_inline)) void enc_edge(void)
 {
+  pin_activity = true;
+
+#if DIAG_ISR
+  //the pins step through 00 01 11 10 one bit at a time, both bits changing means an
+  //edge came and went before this interrupt got to run for it
+  uint8_t raw = (FastPin<ENC_A>::read() ? 1 : 0) | (FastPin<ENC_B>::read() ? 2 : 0);
+  if ((raw ^ enc_raw) == 3)
+    isrMissed(ISR_ENCODER);
+  enc_raw = raw;
+#endif
+
   uint8_t cur_enc = enc_state();
   if (prev_enc == cur_enc) {
     //Serial.println("unnecessary ISR");
     return;
   }
+#if DIAG_HISTOGRAMS
+  if (enc_count == 0)
+    enc_step_at = timerCycles();
+#endif
   //Serial.print(prev_enc);
   //Serial.println(cur_enc);
   
@@ -56,13 +89,45 @@ ISR (PCINT1_vect)
   prev_enc = cur_enc; // Record state for next pulse interpretation
 }
 
+/*
+ * The Interrupt Service Routine for Pin Change Interrupts on A0-A5.
+ * Other than on the AVR, it is attached to each pin's interrupt by pci_setup().
+ */
+#ifdef __AVR__
+ISR (PCINT1_vect)
+#else
+void enc_interrupt(void)
+#endif
+{
+  isrEnter();
+  enc_edge();
+  isrLeave(ISR_ENCODER, 0);
+}
+
+#if BENCHMARKS
+//the interrupt's work for bench.cpp, which can't turn the knob: for a step, the state
+//before it is made up so that the pins as they are count one, and the count is dropped again
+void enc_edge_bench(bool step)
+{
+  if (step)
+    prev_enc = enc_state() == 0 ? 1 : 0;
+  enc_edge();
+  enc_count = 0;
+  enc_count_periodic = 0;
+}
+#endif
+
 /*
  * Setup the encoder interrupts and global variables.
  */
 void pci_setup(byte pin) {
+#ifdef __AVR__
   *digitalPinToPCMSK(pin) |= bit (digitalPinToPCMSKbit(pin));  // enable pin
   PCIFR  |= bit (digitalPinToPCICRbit(pin)); // clear any outstanding interrupt
   PCICR  |= bit (digitalPinToPCICRbit(pin)); // enable interrupt for the group
+#else
+  attachInterrupt(digitalPinToInterrupt(pin), enc_interrupt, CHANGE);
+#endif
 }
 
 void enc_setup(void)
@@ -72,27 +137,57 @@ void enc_setup(void)
   //pinMode(ENC_A, INPUT);
   //pinMode(ENC_B, INPUT);
   prev_enc = enc_state();
+#if DIAG_ISR
+  enc_raw = (FastPin<ENC_A>::read() ? 1 : 0) | (FastPin<ENC_B>::read() ? 2 : 0);
+#endif
 
   // Setup Pin Change Interrupts for the encoder inputs
   pci_setup(ENC_A);
   pci_setup(ENC_B);
 
-  //Set up timer interrupt for momentum
-  TCCR1A = 0;//"normal" mode
-  TCCR1B = 3;//clock divider of 64
-  TCNT1  = 0;//start counting at 0
-  OCR1A  = F_CPU * CALLBACK_PERIOD_MS / 1000 / 64;//set target number
-  TIMSK1 |= (1 << OCIE1A);//enable interrupt
+  // The button and the PTT share the same interrupt, they don't move the encoder
+  // but their edges wake the processor up from the idle sleep
+  pci_setup(FBUTTON);
+  pci_setup(PTT);
+
+  //the momentum is sampled by enc_tick(), from the Timer1 tick set up in timer.cpp
 }
 
-ISR(TIMER1_COMPA_vect)
+/*
+ * Runs inside the tick interrupt once every millisecond,
+ * every CALLBACK_PERIOD_MS the counts since the last sample are pushed into the momentum history
+ */
+void enc_tick(void)
 {
+  if (++momentum_ticks < CALLBACK_PERIOD_MS)
+    return;
+  momentum_ticks = 0;
+
   momentum[2] = momentum[1];
   momentum[1] = momentum[0];
   momentum[0] = enc_count_periodic;
   enc_count_periodic = 0;
 }
 
+#if DIAG_HISTOGRAMS
+uint32_t enc_step_time(void)
+{
+  noInterrupts();
+  uint32_t t = enc_step_at;
+  interrupts();
+  return t;
+}
+#endif
+
+//true if any of the front panel pins have changed since the last call
+bool enc_activity(void)
+{
+  if (!pin_activity)
+    return false;
+  pin_activity = false;
+  return true;
+}
+
 int8_t min_momentum_mag()
 {
   int8_t min_mag = 127;
@@ -106,9 +201,14 @@ int8_t min_momentum_mag()
 }
 
 int enc_read(void) {
-  if(0 != enc_count){
-    int16_t ret = enc_count;
-    int8_t s = (enc_count < 0) ? -1 : 1;
+  //taken and cleared in one go, the interrupt could come between the two bytes
+  noInterrupts();
+  int16_t ret = enc_count;
+  enc_count = 0;
+  interrupts();
+
+  if(0 != ret){
+    int8_t s = (ret < 0) ? -1 : 1;
     int8_t momentum_mag = min_momentum_mag();
     if(momentum_mag >= 20){
       ret += s*40;
@@ -116,7 +216,6 @@ int enc_read(void) {
     else if(momentum_mag >= 5){
       ret += s*(20 + momentum_mag)/(20 - momentum_mag);
     }
-    enc_count = 0;
     return ret;
   }
   return 0;
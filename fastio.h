@@ -0,0 +1,71 @@
+#ifndef _FASTIO_H_
+#define _FASTIO_H_
+
+/**
+ * digitalWrite() and digitalRead() look the pin up in three tables in the flash, check for a
+ * PWM timer on it and save and restore the interrupts, that is 50 to 60 cycles each time.
+ * On the keyer, the T/R switching, the encoder interrupt and the SPI chip selects that adds up.
+ *
+ * FastPin<> does the lookup when compiling. The pin number has to be a constant, then
+ * FastPin<CW_KEY>::high() becomes a single sbi instruction (2 cycles) and
+ * FastPin<PTT>::read() an sbic/in (1 or 2 cycles).
+ *
+ * It follows the Arduino Nano numbering: 0 to 7 are on PORTD, 8 to 13 on PORTB and
+ * A0 (14) to A5 (19) on PORTC. A6 and A7 are analog only and have no port.
+ * It doesn't turn the PWM off like digitalWrite(), the pins must be set up with pinMode()
+ * and digitalWrite() first, as initPorts() does.
+ *
+ * Anywhere but on the AVR it falls back to digitalWrite() and digitalRead().
+ */
+#ifdef __AVR__
+template<uint8_t pin>
+struct FastPin {
+  static_assert(pin < 20, "FastPin only works with D0 to D13 and A0 to A5");
+
+  static const uint8_t mask = 1 << (pin < 8 ? pin : pin < 14 ? pin - 8 : pin - 14);
+
+  static inline void high() {
+    if (pin < 8)
+      PORTD |= mask;
+    else if (pin < 14)
+      PORTB |= mask;
+    else
+      PORTC |= mask;
+  }
+
+  static inline void low() {
+    if (pin < 8)
+      PORTD &= ~mask;
+    else if (pin < 14)
+      PORTB &= ~mask;
+    else
+      PORTC &= ~mask;
+  }
+
+  static inline void write(bool value) {
+    if (value)
+      high();
+    else
+      low();
+  }
+
+  static inline bool read() {
+    if (pin < 8)
+      return PIND & mask;
+    else if (pin < 14)
+      return PINB & mask;
+    else
+      return PINC & mask;
+  }
+};
+#else
+template<uint8_t pin>
+struct FastPin {
+  static inline void high() { digitalWrite(pin, HIGH); }
+  static inline void low() { digitalWrite(pin, LOW); }
+  static inline void write(bool value) { digitalWrite(pin, value ? HIGH : LOW); }
+  static inline bool read() { return digitalRead(pin); }
+};
+#endif //__AVR__
+
+#endif
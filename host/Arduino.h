@@ -0,0 +1,124 @@
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+/**
+ * The part of the Arduino core that the sketch uses, for building it on Linux. See host.h for
+ * what stands in for the Nano: the clock, the pins, the serial port and the devices on the buses.
+ *
+ * The sketch keeps what has to wrap at 32 bits, like millis(), in uint32_t and int32_t, the
+ * AVR's unsigned long and long, so that it wraps the same here where long is 64 bits. int is
+ * still 32 bits here and 16 on the AVR: what can go past 32767 is kept in one of those.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define DEFAULT 1
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+//the Nano's numbering, A6 and A7 are analog only
+static const uint8_t A0 = 14, A1 = 15, A2 = 16, A3 = 17, A4 = 18, A5 = 19, A6 = 20, A7 = 21;
+#define NUM_PINS 22
+
+#define bit(b) (1UL << (b))
+#define _BV(b) (1 << (b))
+
+//the flash is ordinary memory here
+#define PROGMEM
+#define PSTR(s) (s)
+typedef const char *PGM_P;
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper *)(s))
+
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P  memcpy
+#define strcmp_P  strcmp
+#define strncmp_P strncmp
+#define strcpy_P  strcpy
+#define strncpy_P strncpy
+#define strcat_P  strcat
+#define strlen_P  strlen
+
+char *itoa(int value, char *text, int base);
+char *ltoa(int64_t value, char *text, int base);
+char *ultoa(uint64_t value, char *text, int base);
+
+//the virtual clock, millis() and micros() wrap at 32 bits as on the Nano
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+void tone(uint8_t pin, unsigned int frequency, uint64_t duration = 0);
+void noTone(uint8_t pin);
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(int interrupt, void (*isr)(void), int mode);
+void noInterrupts();
+void interrupts();
+
+/**
+ * Serial, with the 64 byte buffers of the HardwareSerial on the Nano. What is written takes the
+ * time of the wire at the baud rate set by begin(), a write to a full buffer waits for room.
+ */
+class HardwareSerial {
+public:
+  void begin(uint64_t baud);
+  void end() {}
+  int available();
+  int peek();
+  int read();
+  void flush();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *data, size_t n);
+  size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t write(int c) { return write((uint8_t)c); }
+
+  size_t print(const char *text) { return write(text); }
+  size_t print(const __FlashStringHelper *text) { return write((const char *)text); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n, int base = DEC) { return print((int64_t)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((uint64_t)n, base); }
+  size_t print(int64_t n, int base = DEC);
+  size_t print(uint64_t n, int base = DEC);
+
+  size_t println() { return write("\r\n"); }
+  template<class T> size_t println(T value) { size_t n = print(value); return n + println(); }
+  template<class T> size_t println(T value, int base) { size_t n = print(value, base); return n + println(); }
+
+  operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _HOST_SPI_H_
+#define _HOST_SPI_H_
+
+#include <Arduino.h>
+
+/**
+ * The SPI port of the Nano, with the ILI9341 display and the XPT2046 touch controller on it as
+ * the Raduino has them. Which of them a byte goes to is up to their chip select pins, TFT_CS
+ * and CS_PIN. Each byte takes the time of the wire at the clock last set, see spi.cpp.
+ */
+#define SPI_CLOCK_DIV4   0x00
+#define SPI_CLOCK_DIV16  0x01
+#define SPI_CLOCK_DIV64  0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2   0x04
+#define SPI_CLOCK_DIV8   0x05
+#define SPI_CLOCK_DIV32  0x06
+
+#define MSBFIRST 1
+#define LSBFIRST 0
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings {
+public:
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock) {}
+  SPISettings() : clock(4000000) {}
+  uint32_t clock;
+};
+
+class SPIClass {
+public:
+  void begin();
+  void end() {}
+  void setClockDivider(uint8_t divider);
+  void setBitOrder(uint8_t order) {}
+  void setDataMode(uint8_t mode) {}
+  void beginTransaction(SPISettings settings);
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data);
+  uint16_t transfer16(uint16_t data);
+  void transfer(void *buf, size_t count);
+};
+extern SPIClass SPI;
+
+#endif
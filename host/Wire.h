@@ -0,0 +1,21 @@
+#ifndef _HOST_WIRE_H_
+#define _HOST_WIRE_H_
+
+#include <Arduino.h>
+
+/**
+ * The I2C port of the Nano with the Si5351 at 0x60 on it, see wire.cpp. A transmission is
+ * put on the bus by endTransmission(), at 100 kHz as the Wire library starts out.
+ */
+class TwoWire {
+public:
+  void begin();
+  void setClock(uint32_t clock);
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t n);
+  uint8_t endTransmission(bool stop = true);
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,2 @@
+//the flash is ordinary memory on the host, Arduino.h has all of it
+#include <Arduino.h>
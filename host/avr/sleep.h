@@ -0,0 +1,13 @@
+#ifndef _HOST_SLEEP_H_
+#define _HOST_SLEEP_H_
+
+/**
+ * The idle sleep moves the virtual clock on to the next interrupt: the tick, a pin change,
+ * a byte on the serial port or an event a harness has set up, see clock.cpp.
+ */
+#define SLEEP_MODE_IDLE 0
+
+#define set_sleep_mode(mode)
+void sleep_mode();
+
+#endif
@@ -0,0 +1,259 @@
+#include <map>
+#include "host.h"
+#include <avr/sleep.h>
+
+/**
+ * The virtual clock, the interrupts, the pins and the odds and ends of the Arduino core.
+ *
+ * Time only moves when the sketch waits for something, see host.h. Whatever is due on the way
+ * runs in time order: the tick every millisecond, the harness's events and, through them, the
+ * pin change interrupts and the bytes arriving on the serial port. An interrupt or an event
+ * can't move the clock itself, what it would have waited for is taken as instant.
+ */
+void timer_tick();
+
+uint64_t hostPassNs = 20 * HOST_USEC;
+
+static uint64_t now = 0;
+static uint64_t nextTick = HOST_MSEC;
+static uint32_t millisStart = 0;
+static std::multimap<uint64_t, std::function<void()>> events;
+
+static bool interruptsOn = true;
+static int inInterrupt = 0;
+static std::vector<void (*)()> pendingIsrs;   //came while the interrupts were off
+
+static void runIsr(void (*isr)()) {
+  if (!interruptsOn) {
+    //like the interrupt flags, one pending of each kind at most
+    for (size_t i = 0; i < pendingIsrs.size(); i++)
+      if (pendingIsrs[i] == isr)
+        return;
+    pendingIsrs.push_back(isr);
+    return;
+  }
+  inInterrupt++;
+  isr();
+  inInterrupt--;
+}
+
+uint64_t hostNanos() {
+  return now;
+}
+
+void hostAdvance(uint64_t ns) {
+  if (inInterrupt)
+    return;
+
+  uint64_t until = now + ns;
+  for (;;) {
+    bool tick = events.empty() || nextTick <= events.begin()->first;
+    uint64_t next = tick ? nextTick : events.begin()->first;
+    if (next > until)
+      break;
+    if (next > now)
+      now = next;
+
+    if (tick) {
+      nextTick += HOST_MSEC;
+      runIsr(timer_tick);
+    }
+    else {
+      std::function<void()> event = events.begin()->second;
+      events.erase(events.begin());
+      inInterrupt++;
+      event();
+      inInterrupt--;
+    }
+  }
+  now = until;
+}
+
+void hostAt(uint64_t ns, std::function<void()> event) {
+  events.insert(std::make_pair(ns, event));
+}
+
+void hostBoot() {
+  setup();
+}
+
+void hostRun(uint64_t ns) {
+  while (now < ns) {
+    hostSerialPoll();
+    loop();
+    hostAdvance(hostPassNs);
+  }
+}
+
+void hostMillisStart(uint32_t ms) {
+  millisStart = ms;
+}
+
+//the idle sleep of timer.cpp, until the next interrupt
+void sleep_mode() {
+  uint64_t next = nextTick;
+  if (!events.empty() && events.begin()->first < next)
+    next = events.begin()->first;
+  hostAdvance(next > now ? next - now : 0);
+}
+
+void noInterrupts() {
+  interruptsOn = false;
+}
+
+void interrupts() {
+  interruptsOn = true;
+  std::vector<void (*)()> pending;
+  pending.swap(pendingIsrs);
+  for (size_t i = 0; i < pending.size(); i++)
+    runIsr(pending[i]);
+}
+
+//reading the clock costs about as much as on the Nano, a loop that waits on it gets there
+uint32_t millis() {
+  uint32_t ms = millisStart + (uint32_t)(now / HOST_MSEC);
+  hostAdvance(HOST_USEC);
+  return ms;
+}
+
+uint32_t micros() {
+  uint32_t us = millisStart * 1000u + (uint32_t)(now / HOST_USEC);
+  hostAdvance(3 * HOST_USEC);
+  return us;
+}
+
+void delay(uint32_t ms) {
+  hostAdvance(ms * HOST_MSEC);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostAdvance(us * HOST_USEC);
+}
+
+/**
+ * The pins
+ */
+static uint8_t pinModes[NUM_PINS];
+static uint8_t pinOut[NUM_PINS];
+static uint8_t pinIn[NUM_PINS] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+static int analogIn[8] = {1023, 1023, 1023, 1023, 1023, 1023, 1023, 1023};
+static void (*pinIsr[NUM_PINS])();
+static std::function<void(int level)> pinWatch[NUM_PINS];
+static unsigned int toneFrequency;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < NUM_PINS)
+    pinModes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= NUM_PINS)
+    return;
+  level = level ? HIGH : LOW;
+  if (pinOut[pin] == level)
+    return;
+  pinOut[pin] = level;
+  if (pinWatch[pin]) {
+    inInterrupt++;
+    pinWatch[pin](level);
+    inInterrupt--;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= NUM_PINS)
+    return LOW;
+  return pinModes[pin] == OUTPUT ? pinOut[pin] : pinIn[pin];
+}
+
+//a conversion takes 13 cycles of the 125 kHz ADC clock, and a bit to start it
+int analogRead(uint8_t pin) {
+  uint8_t channel = pin >= A0 ? pin - A0 : pin;
+  hostAdvance(112 * HOST_USEC);
+  return channel < 8 ? analogIn[channel] : 0;
+}
+
+void analogReference(uint8_t mode) {
+}
+
+void attachInterrupt(int interrupt, void (*isr)(void), int mode) {
+  if (interrupt >= 0 && interrupt < NUM_PINS)
+    pinIsr[interrupt] = isr;
+}
+
+void tone(uint8_t pin, unsigned int frequency, uint64_t duration) {
+  toneFrequency = frequency;
+}
+
+void noTone(uint8_t pin) {
+  toneFrequency = 0;
+}
+
+void hostPin(uint8_t pin, int level) {
+  if (pin >= NUM_PINS)
+    return;
+  level = level ? HIGH : LOW;
+  if (pinIn[pin] == level)
+    return;
+  pinIn[pin] = level;
+  if (pinIsr[pin])
+    runIsr(pinIsr[pin]);
+}
+
+int hostPinOut(uint8_t pin) {
+  return pin < NUM_PINS ? pinOut[pin] : LOW;
+}
+
+void hostOnPin(uint8_t pin, std::function<void(int level)> changed) {
+  if (pin < NUM_PINS)
+    pinWatch[pin] = changed;
+}
+
+void hostAnalog(uint8_t pin, int value) {
+  uint8_t channel = pin >= A0 ? pin - A0 : pin;
+  if (channel < 8)
+    analogIn[channel] = value;
+}
+
+unsigned int hostTone() {
+  return toneFrequency;
+}
+
+/**
+ * The number conversions of the AVR libc
+ */
+static char *convert(uint64_t value, bool negative, char *text, int base) {
+  char digits[66];
+  int n = 0;
+
+  do {
+    int digit = value % base;
+    digits[n++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+
+  char *p = text;
+  if (negative)
+    *p++ = '-';
+  while (n)
+    *p++ = digits[--n];
+  *p = 0;
+  return text;
+}
+
+char *itoa(int value, char *text, int base) {
+  //as on the AVR, only base 10 has a sign
+  if (base == 10 && value < 0)
+    return convert(-(int64_t)value, true, text, base);
+  return convert((unsigned int)value, false, text, base);
+}
+
+char *ltoa(int64_t value, char *text, int base) {
+  if (base == 10 && value < 0)
+    return convert(-value, true, text, base);
+  return convert((uint64_t)value, false, text, base);
+}
+
+char *ultoa(uint64_t value, char *text, int base) {
+  return convert(value, false, text, base);
+}
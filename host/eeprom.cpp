@@ -0,0 +1,90 @@
+#include "host.h"
+#include <EEPROM.h>
+
+/**
+ * The EEPROM, written through to the file hostEepromFile() names so that the settings outlast
+ * a run as they outlast a power cycle. A write takes 3.4 msec, the time of the erase and write
+ * on the chip, the sketch waits for it.
+ */
+EEPROMClass EEPROM;
+
+static uint8_t memory[EEPROM_SIZE];
+static bool blank = false;
+static FILE *file = NULL;
+
+static uint8_t *cells() {
+  if (!blank) {
+    memset(memory, 0xff, sizeof(memory));
+    blank = true;
+  }
+  return memory;
+}
+
+uint8_t EEPROMClass::read(int address) {
+  if (address < 0 || address >= EEPROM_SIZE)
+    return 0xff;
+  return cells()[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  if (address < 0 || address >= EEPROM_SIZE)
+    return;
+  hostAdvance(3400 * HOST_USEC);
+  cells()[address] = value;
+  if (file) {
+    fseek(file, address, SEEK_SET);
+    fputc(value, file);
+    fflush(file);
+  }
+}
+
+void EEPROMClass::update(int address, uint8_t value) {
+  if (read(address) != value)
+    write(address, value);
+}
+
+void hostEepromFile(const char *path) {
+  if (file)
+    fclose(file);
+  file = fopen(path, "r+b");
+  if (!file)
+    file = fopen(path, "w+b");
+  if (!file)
+    return;
+
+  //what isn't in the file yet is blank, or what was there before
+  size_t n = fread(cells(), 1, EEPROM_SIZE, file);
+  if (n < EEPROM_SIZE) {
+    fseek(file, n, SEEK_SET);
+    fwrite(cells() + n, 1, EEPROM_SIZE - n, file);
+    fflush(file);
+  }
+}
+
+uint8_t *hostEeprom() {
+  return cells();
+}
+
+//puts a value straight in, without the time of the write
+static void preset(int address, const void *value, size_t n) {
+  memcpy(cells() + address, value, n);
+  if (file) {
+    fseek(file, address, SEEK_SET);
+    fwrite(value, 1, n, file);
+    fflush(file);
+  }
+}
+
+void hostEepromDefaults() {
+  int32_t touch[4] = {104, 137, 28, 29};      //SLOPE_X, SLOPE_Y, OFFSET_X and OFFSET_Y, the sketch's own numbers
+  int32_t calibration = 0;
+  uint32_t usbCarrier = 11052000;
+  uint8_t modes[4] = {0, 0, 0, 0};            //VFO A and B, the sideband from the frequency and no CW
+  uint8_t straightKey = 0;
+
+  preset(0, &calibration, sizeof(calibration));
+  preset(8, &usbCarrier, sizeof(usbCarrier));
+  preset(32, touch, sizeof(touch));
+  preset(256, modes, sizeof(modes));
+  preset(358, &straightKey, sizeof(straightKey));
+}
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <inttypes.h>
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * The benchmarks of bench.cpp on the host: each routine with the same input as on the radio,
+ * timed with the host's own clock, in nsec per call. The sketch has no heap to speak of, any
+ * call to malloc() or new on the way is counted and shows up as allocations per call.
+ *
+ *   ubitx_bench [--quick] [name...]
+ *
+ * Next to the host's time, the time the Nano would have spent waiting on the SPI and I2C
+ * buses for the call, from the virtual clock. --quick runs each one only as often as the
+ * radio would, for the test that fails on an allocation.
+ */
+int benchCount();
+const char *benchName(int i);
+void benchCall(int i);
+
+extern "C" void *__libc_malloc(size_t n);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t n);
+extern "C" void __libc_free(void *p);
+
+static uint64_t allocations = 0;
+
+extern "C" void *malloc(size_t n) {
+  allocations++;
+  return __libc_malloc(n);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+  allocations++;
+  return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t n) {
+  allocations++;
+  return __libc_realloc(p, n);
+}
+
+extern "C" void free(void *p) {
+  __libc_free(p);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t since(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+  bool quick = false;
+  std::vector<std::string> only;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--quick"))
+      quick = true;
+    else
+      only.push_back(argv[i]);
+  }
+
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+  hostSerialReceived();
+
+  printf("%-16s %10s %10s %10s %12s\n", "routine", "ns/op", "min ns", "allocs/op", "nano us/op");
+  uint64_t allocated = 0;
+  for (int i = 0; i < benchCount(); i++) {
+    if (!only.empty() && std::find(only.begin(), only.end(), benchName(i)) == only.end())
+      continue;
+
+    //the calls are timed in batches, one is too short for the clock, for up to 50 msec each
+    int batch = quick ? 1 : 100, batches = quick ? 10 : 200;
+    uint64_t total = 0, least = ~0ull, waited = 0, calls = 0;
+    uint64_t before = allocations;
+    for (int b = 0; b < batches && (b < 3 || total < 50 * HOST_MSEC); b++) {
+      uint64_t virtualStart = hostNanos();
+      Clock::time_point start = Clock::now();
+      for (int n = 0; n < batch; n++)
+        benchCall(i);
+      uint64_t ns = since(start);
+      waited += hostNanos() - virtualStart;
+      total += ns;
+      least = std::min(least, ns / batch);
+      calls += batch;
+    }
+    uint64_t allocs = allocations - before;
+    allocated += allocs;
+
+    printf("%-16s %10.1f %10" PRIu64 " %10.2f %12.1f\n", benchName(i), (double)total / calls,
+           least, (double)allocs / calls, (double)waited / calls / HOST_USEC);
+  }
+  return allocated ? 1 : 0;
+}
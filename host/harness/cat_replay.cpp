@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * tools/cat_replay.py's replay against the host build instead of the radio: the program's
+ * side of a recorded session goes to checkCAT() over the virtual serial port at the pace it
+ * was recorded, and each command is timed until as many bytes have come back as in the
+ * recording.
+ *
+ *   ubitx_cat_replay [--timeout 0.5] session...
+ *
+ * A session is the recorder's: a line per burst of bytes, the seconds since the start, > for
+ * what the program sent and < for what the radio answered, the bytes in hex. The answer is
+ * timed from the frame's first byte going on the wire to the last byte of the answer off it,
+ * both at 38400 baud, as a program would see it. Per command the p50, p99, worst and the
+ * commands never answered in time, then what the sketch itself counted (DIAG_CAT_COMMANDS):
+ * the frames cut short and the frames dropped while another command was still running.
+ * It fails if any of them was lost, for the test that keeps the sessions in host/harness/sessions
+ * working. Those are synthetic, written by hand after the polling of each program, not
+ * recorded off a radio.
+ */
+struct Frame {
+  double when;
+  uint8_t bytes[5];
+  size_t answer;
+};
+
+struct Times {
+  std::vector<double> ms;
+  int timeouts;
+};
+
+static size_t got;
+static uint64_t lastByteAt;
+
+static const char *commandName(uint8_t command) {
+  switch (command) {
+  case 0x01: return "set freq";
+  case 0x02: return "split on";
+  case 0x82: return "split off";
+  case 0x03: return "get freq";
+  case 0x07: return "set mode";
+  case 0x08: return "ptt on";
+  case 0x88: return "ptt off";
+  case 0x81: return "vfo toggle";
+  case 0xbb: return "read eeprom";
+  case 0xe7: return "rx status";
+  case 0xf7: return "tx status";
+  }
+  return NULL;
+}
+
+//as the recorder reads it: the program's bytes cut into frames, the radio's counted against the last one
+static bool load(const char *path, std::vector<Frame> &frames) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+  char line[1100], way[4], hex[1030];
+  std::vector<uint8_t> pending;
+  double when;
+  while (fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "%lf %3s %1029s", &when, way, hex) != 3)
+      continue;
+    size_t n = strlen(hex) / 2;
+    if (way[0] == '>') {
+      for (size_t i = 0; i < n; i++) {
+        unsigned int b;
+        sscanf(hex + 2 * i, "%2x", &b);
+        pending.push_back(b);
+      }
+      while (pending.size() >= 5) {
+        Frame frame = {when, {0}, 0};
+        memcpy(frame.bytes, pending.data(), 5);
+        frames.push_back(frame);
+        pending.erase(pending.begin(), pending.begin() + 5);
+      }
+    }
+    else if (!frames.empty())
+      frames.back().answer += n;
+  }
+  fclose(f);
+  return true;
+}
+
+static double percentile(std::vector<double> times, double p) {
+  std::sort(times.begin(), times.end());
+  return times[std::min(times.size() - 1, (size_t)(times.size() * p / 100))];
+}
+
+//what checkCAT() counted, over CAT as on the radio: the timeouts and the drops lead the answer
+static void sketchCounts(unsigned int &cutShort, unsigned int &dropped) {
+  uint8_t frame[5] = {0xff, 0, 0, 0, 0xd6};
+  std::string answer;
+  hostOnSerial([&answer](uint8_t c) { answer += (char)c; });
+  hostSerialSend(frame, 5);
+  hostRun(hostNanos() + 100 * HOST_MSEC);
+  hostOnSerial(nullptr);
+  //2 bytes each, low byte first, as the Nano sends them
+  cutShort = dropped = 0;
+  if (answer.size() >= 6) {
+    cutShort = (uint8_t)answer[0] | (uint8_t)answer[1] << 8;
+    dropped = (uint8_t)answer[2] | (uint8_t)answer[3] << 8;
+  }
+}
+
+static int replay(const std::vector<Frame> &frames, double timeout) {
+  std::map<uint8_t, Times> stats;
+  hostOnSerial([](uint8_t c) {
+    got++;
+    lastByteAt = hostNanos();
+  });
+
+  uint64_t start = hostNanos();
+  int timeouts = 0;
+  for (size_t i = 0; i < frames.size(); i++) {
+    const Frame &frame = frames[i];
+    hostRun(start + (uint64_t)(frame.when * HOST_SEC));
+    got = 0;
+    uint64_t sent = hostNanos();
+    hostSerialSend(frame.bytes, 5);
+    while (got < frame.answer && hostNanos() - sent < (uint64_t)(timeout * HOST_SEC))
+      hostRun(hostNanos() + 1);
+
+    Times &times = stats[frame.bytes[4]];
+    if (got < frame.answer) {
+      times.timeouts++;
+      timeouts++;
+    }
+    else if (frame.answer)
+      times.ms.push_back((lastByteAt - sent) / 1e6);
+  }
+
+  printf("%-12s %6s %8s %8s %8s %8s\n", "command", "count", "p50 ms", "p99 ms", "max ms", "timeouts");
+  for (std::map<uint8_t, Times>::iterator it = stats.begin(); it != stats.end(); ++it) {
+    char code[8];
+    const char *name = commandName(it->first);
+    if (!name) {
+      snprintf(code, sizeof(code), "%02x", it->first);
+      name = code;
+    }
+    std::vector<double> &ms = it->second.ms;
+    if (ms.empty())
+      printf("%-12s %6d %8s %8s %8s %8d\n", name, 0, "-", "-", "-", it->second.timeouts);
+    else
+      printf("%-12s %6zu %8.1f %8.1f %8.1f %8d\n", name, ms.size(), percentile(ms, 50),
+             percentile(ms, 99), *std::max_element(ms.begin(), ms.end()), it->second.timeouts);
+  }
+  return timeouts;
+}
+
+int main(int argc, char **argv) {
+  double timeout = 0.5;
+  std::vector<const char *> sessions;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--timeout") && i + 1 < argc)
+      timeout = atof(argv[++i]);
+    else
+      sessions.push_back(argv[i]);
+  }
+  if (sessions.empty()) {
+    fprintf(stderr, "usage: ubitx_cat_replay [--timeout 0.5] session...\n");
+    return 2;
+  }
+
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+
+  int failed = 0;
+  for (size_t s = 0; s < sessions.size(); s++) {
+    std::vector<Frame> frames;
+    if (!load(sessions[s], frames) || frames.empty()) {
+      fprintf(stderr, "%s: can't read the session\n", sessions[s]);
+      failed++;
+      continue;
+    }
+    printf("%s, %zu frames over %.1f s\n", sessions[s], frames.size(), frames.back().when);
+    unsigned int overruns = hostSerialOverruns();
+    int timeouts = replay(frames, timeout);
+
+    unsigned int cutShort, dropped;
+    overruns = hostSerialOverruns() - overruns;
+    sketchCounts(cutShort, dropped);
+    printf("sketch: %u frames cut short, %u dropped; serial port: %u bytes overrun\n\n",
+           cutShort, dropped, overruns);
+    diagReset();
+    if (timeouts || cutShort || dropped || overruns)
+      failed++;
+  }
+  return failed ? 1 : 0;
+}
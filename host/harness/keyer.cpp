@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * The keyer against PARIS: the word sent with the paddle and with the straight key into
+ * cwKeyer() on the virtual clock, at 5 to 60 WPM, and each mark and space on CW_KEY
+ * timed against the ideal ones, a dot of 1200/WPM msec.
+ *
+ *   ubitx_keyer [--quick] [--words 2]
+ *
+ * The paddle goes through analogRead(ANALOG_KEYER) as its resistors would put it, iambic
+ * A and B. The operator is a perfect one who listens: the paddle of the next element goes
+ * down half a dot into the space after a mark and comes up as soon as that element keys,
+ * and the first element of a letter goes down three dots after the last mark, seven after
+ * a word. The straight key, on the keyer input and on the PTT as well, is held down for
+ * exactly the ideal marks. Each is run without load, with the command bar written four
+ * times a second in between the passes of loop(), 40 msec each, and with CAT polled ten
+ * times a second.
+ *
+ * Per run the marks and the spaces inside a letter, and the gaps between letters and
+ * words, in msec off the ideal: the mean and the worst. A mark that brought the transmitter
+ * up waits out delayBeforeCWStartTime first, by design; those are counted apart and left
+ * out with the spaces around them, and the straight key's elements that were over before
+ * it was up are counted as clipped. It fails if a run without the screen load lost an
+ * element or keyed one too many, for the test; the straight key can't get through a
+ * repaint, under the screen load it loses the dits that fall in one.
+ */
+extern unsigned char keyerState;   //keyer.cpp
+
+enum Key { IAMBIC_A, IAMBIC_B, STRAIGHT, PTT_KEY };
+enum Load { NO_LOAD, SCREEN_LOAD, CAT_LOAD };
+
+static const char *keyNames[] = {"iambic A", "iambic B", "straight", "ptt"};
+static const char *loadNames[] = {"-", "screen", "cat"};
+
+//the paddle's voltages as analogRead() reads them, see keyer.cpp
+#define PADDLE_UP 1023
+#define PADDLE_DIT 450
+#define PADDLE_DAH 700
+#define STRAIGHT_DOWN 20
+
+struct Element {
+  int units;      //1 for a dit, 3 for a dah
+  int space;      //the dots after it, 1 in a letter, 3 between letters, 7 between words
+};
+
+struct Mark {
+  uint64_t down, up;
+  bool started;   //it brought the transmitter up
+};
+
+static std::vector<Element> want;
+static std::vector<Mark> marks;
+static std::vector<uint64_t> keys;    //when the straight key goes down for each element
+static bool txDown;
+static Key key;
+static uint64_t dot;
+static int polling, runs;    //the run being polled, the ones before drop their polls
+
+static void paris(int words) {
+  static const char *letters[] = {".--.", ".-", ".-.", "..", "..."};
+  want.clear();
+  for (int w = 0; w < words; w++)
+    for (int l = 0; l < 5; l++)
+      for (const char *e = letters[l]; *e; e++) {
+        Element element = {*e == '-' ? 3 : 1, e[1] ? 1 : (l < 4 ? 3 : 7)};
+        want.push_back(element);
+      }
+}
+
+static void press(size_t i) {
+  if (i < want.size())
+    hostAnalog(ANALOG_KEYER, want[i].units == 3 ? PADDLE_DAH : PADDLE_DIT);
+}
+
+//the operator's ear on the sidetone, the paddles are worked from what was keyed
+static void keyed(int level) {
+  uint64_t now = hostNanos();
+  if (level) {
+    Mark mark = {now, 0, txDown};
+    marks.push_back(mark);
+    txDown = false;
+    if (key == IAMBIC_A || key == IAMBIC_B)
+      hostAnalog(ANALOG_KEYER, PADDLE_UP);
+    return;
+  }
+  if (marks.empty())
+    return;
+  marks.back().up = now;
+  size_t next = marks.size();
+  if ((key == IAMBIC_A || key == IAMBIC_B) && next < want.size()) {
+    int space = want[next - 1].space;
+    hostAt(now + (space == 1 ? dot / 2 : space * dot), [next]() { press(next); });
+  }
+}
+
+static void straightKey(bool down) {
+  if (key == PTT_KEY)
+    hostPin(PTT, down ? LOW : HIGH);
+  else
+    hostAnalog(ANALOG_KEYER, down ? STRAIGHT_DOWN : PADDLE_UP);
+}
+
+static void catPoll(uint64_t at, int n, int id) {
+  static const uint8_t polls[] = {0x03, 0xf7, 0xe7};
+  hostAt(at, [at, n, id]() {
+    if (polling != id)
+      return;
+    uint8_t frame[5] = {0, 0, 0, 0, polls[n % 3]};
+    hostSerialSend(frame, 5);
+    catPoll(at + 100 * HOST_MSEC, n + 1, id);
+  });
+}
+
+struct Errors {
+  double sum, worst;
+  int n;
+  void add(double ms) {
+    sum += fabs(ms);
+    if (fabs(ms) > fabs(worst))
+      worst = ms;
+    n++;
+  }
+};
+
+static bool run(Key k, int wpm, Load load) {
+  key = k;
+  dot = 1200 / wpm * HOST_MSEC;
+  cwSpeed = 1200 / wpm;
+  Iambic_Key = key == IAMBIC_A || key == IAMBIC_B;
+  keyerControl = key == IAMBIC_B ? IAMBICB : 0;
+  keyerState = 0;
+  marks.clear();
+  keys.clear();
+  txDown = !inTx;
+
+  uint64_t start = hostNanos() + 10 * HOST_MSEC, end = start;
+  if (Iambic_Key) {
+    hostAt(start, []() { press(0); });
+    for (size_t i = 0; i < want.size(); i++)
+      end += (want[i].units + want[i].space) * dot;
+  }
+  else
+    for (size_t i = 0; i < want.size(); i++) {
+      keys.push_back(end);
+      hostAt(end, []() { straightKey(true); });
+      end += want[i].units * dot;
+      hostAt(end, []() { straightKey(false); });
+      end += want[i].space * dot;
+    }
+  //room for the transmitter coming up, and for the hang time after
+  end += 2 * HOST_SEC;
+
+  polling = load == CAT_LOAD ? ++runs : 0;
+  if (polling)
+    catPoll(start, 0, polling);
+  uint64_t repaint = start;
+  while (hostNanos() < end || inTx) {
+    hostSerialPoll();
+    loop();
+    if (load == SCREEN_LOAD && hostNanos() >= repaint) {
+      printCarrierFreq(frequency);
+      repaint += 250 * HOST_MSEC;
+    }
+    hostAdvance(hostPassNs);
+  }
+  polling = 0;
+  hostAnalog(ANALOG_KEYER, PADDLE_UP);
+  hostPin(PTT, HIGH);
+
+  //the marks to the elements: in turn for the paddle, the keyer times them; by when they were
+  //keyed for the straight key, the operator does
+  std::vector<int> match(want.size(), -1);
+  int extra = 0;
+  for (size_t m = 0; m < marks.size(); m++) {
+    size_t best = m;
+    if (!Iambic_Key) {
+      int64_t most = INT64_MIN;
+      for (size_t i = 0; i < want.size(); i++) {
+        uint64_t from = std::max(marks[m].down, keys[i]), to = std::min(marks[m].up, keys[i] + want[i].units * dot);
+        int64_t overlap = (int64_t)to - (int64_t)from;
+        if (overlap > most) {
+          most = overlap;
+          best = i;
+        }
+      }
+    }
+    if (best < want.size() && match[best] < 0)
+      match[best] = m;
+    else
+      extra++;
+  }
+
+  Errors mark = {0, 0, 0}, space = {0, 0, 0}, gap = {0, 0, 0};
+  int starts = 0, clipped = 0, lost = 0;
+  double ms = dot / 1e6;
+  for (size_t i = 0; i < want.size(); i++) {
+    if (match[i] < 0) {
+      //an element before the transmitter was up is lost to the start delay
+      size_t j = i;
+      while (j < want.size() && match[j] < 0)
+        j++;
+      if (j < want.size() && marks[match[j]].started)
+        clipped++;
+      else
+        lost++;
+      continue;
+    }
+    const Mark &keyed = marks[match[i]];
+    if (keyed.started) {
+      starts++;
+      continue;
+    }
+    mark.add((keyed.up - keyed.down) / 1e6 - want[i].units * ms);
+    if (i && match[i - 1] >= 0 && !marks[match[i - 1]].started) {
+      double off = (keyed.down - marks[match[i - 1]].up) / 1e6 - want[i - 1].space * ms;
+      if (want[i - 1].space == 1)
+        space.add(off);
+      else
+        gap.add(off);
+    }
+  }
+
+  printf("%-8s %4d %-6s %5zu/%-4zu %6d %7d %4d %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", keyNames[key], wpm,
+         loadNames[load], marks.size(), want.size(), starts, clipped, lost + extra,
+         mark.n ? mark.sum / mark.n : 0, mark.worst, space.n ? space.sum / space.n : 0, space.worst,
+         gap.n ? gap.sum / gap.n : 0, gap.worst);
+  return (!lost && !extra) || load == SCREEN_LOAD;
+}
+
+int main(int argc, char **argv) {
+  static const int speeds[] = {5, 10, 15, 20, 25, 30, 40, 50, 60};
+  static const int quick[] = {5, 20, 60};
+  bool fast = false;
+  int words = 2;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--quick"))
+      fast = true;
+    else if (!strcmp(argv[i], "--words") && i + 1 < argc)
+      words = atoi(argv[++i]);
+  }
+  paris(std::max(words, 1));
+
+  hostEepromDefaults();
+  hostEeprom()[VFO_A_CW_MODE] = 1;
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+  hostOnPin(CW_KEY, keyed);
+  hostOnPin(TX_RX, [](int level) {
+    if (!level && !inTx)
+      txDown = true;
+  });
+  //the answers to the polls go nowhere
+  hostOnSerial([](uint8_t c) {});
+
+  printf("%-8s %4s %-6s %10s %6s %7s %4s %8s %8s %8s %8s %8s %8s\n", "key", "wpm", "load", "elements",
+         "starts", "clipped", "lost", "mark", "worst", "space", "worst", "gap", "worst");
+  int failed = 0;
+  for (int k = IAMBIC_A; k <= PTT_KEY; k++)
+    for (int load = NO_LOAD; load <= CAT_LOAD; load++)
+      for (size_t s = 0; s < (fast ? 3 : sizeof(speeds) / sizeof(speeds[0])); s++)
+        if (!run((Key)k, fast ? quick[s] : speeds[s], (Load)load))
+          failed++;
+  return failed ? 1 : 0;
+}
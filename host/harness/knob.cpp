@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * Knob to glass: input traces played into the sketch, each step of the knob timed to the
+ * Si5351 taking the new frequency and to the last pixel of it on the display.
+ *
+ *   ubitx_knob [--synth99 100] [--glass99 1000] trace...
+ *
+ * A trace is a text file, a line per input, times in msec from the start of the trace:
+ *
+ *   # comment
+ *   0 enc 0 1            the encoder's A and B pins, edge by edge
+ *   100 turn 20 50       20 detents clockwise, 50 msec each, -20 the other way
+ *   400 touch 30 98      a finger on the screen at x, y
+ *   550 release
+ *   900 button 0         the function button down, 1 up
+ *
+ * A step is an edge of the encoder that moves enc_count. It is on the synthesizer when CLK2
+ * next changes, and on the glass with the last pixel written into the vfo boxes by the first
+ * repaint after that. For each trace the p50, p99 and worst of both, in msec; the steps that
+ * never got there, in a dialog or at the end of the band, are counted apart.
+ *
+ * A trace fails if a step was lost, or if a p99 is over its bound, in msec, for the test.
+ * The traces in host/harness/traces are synthetic, written by hand after how a knob is
+ * turned; none was recorded off a radio.
+ */
+extern int16_t enc_count;          //encoder.cpp
+void enc_interrupt(void);
+
+struct Input {
+  double ms;
+  std::string what;
+  int a, b;
+};
+
+static std::vector<uint64_t> waitingSynth;   //the times of the steps on their way
+static std::vector<std::pair<uint64_t, uint64_t>> waitingGlass;    //and of their synthesizer update
+static std::vector<double> toSynth, toGlass;
+
+static void encoderEdge() {
+  int before = enc_count;
+  enc_interrupt();
+  for (int i = 0; i < abs(enc_count - before); i++)
+    waitingSynth.push_back(hostNanos());
+}
+
+static double percentile(std::vector<double> v, double p) {
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  size_t rank = (size_t)(p / 100 * v.size() + 0.999999);
+  return v[rank ? rank - 1 : 0];
+}
+
+static bool load(const char *path, std::vector<Input> &inputs) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+  char line[200];
+  while (fgets(line, sizeof(line), f)) {
+    Input in = {0, "", 0, 0};
+    char what[16];
+    if (line[0] == '#' || sscanf(line, "%lf %15s %d %d", &in.ms, what, &in.a, &in.b) < 2)
+      continue;
+    in.what = what;
+    inputs.push_back(in);
+  }
+  fclose(f);
+  return true;
+}
+
+static void schedule(uint64_t start, const Input &in) {
+  static const uint8_t cw[4][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+  static const uint8_t ccw[4][2] = {{1, 0}, {0, 0}, {0, 1}, {1, 1}};
+  uint64_t at = start + (uint64_t)(in.ms * HOST_MSEC);
+  int a = in.a, b = in.b;
+
+  if (in.what == "enc")
+    hostAt(at, [a, b]() {
+      hostPin(ENC_A, a);
+      hostPin(ENC_B, b);
+    });
+  else if (in.what == "turn") {
+    //a quadrature cycle per detent, from the rest with both pins high
+    uint64_t apart = (uint64_t)b * HOST_MSEC;
+    for (int i = 0; i < abs(a); i++)
+      for (int j = 0; j < 4; j++) {
+        const uint8_t *level = a > 0 ? cw[j] : ccw[j];
+        hostAt(at + i * apart + (j + 1) * apart / 4, [level]() {
+          hostPin(ENC_A, level[0]);
+          hostPin(ENC_B, level[1]);
+        });
+      }
+  }
+  else if (in.what == "touch")
+    hostAt(at, [a, b]() { hostTouch(a, b); });
+  else if (in.what == "release")
+    hostAt(at, hostTouchRelease);
+  else if (in.what == "button")
+    hostAt(at, [a]() { hostPin(FBUTTON, a); });
+}
+
+static double synthBound = 100, glassBound = 1000;
+
+static bool report(const char *name, size_t steps) {
+  printf("%-24s %6zu %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %6zu\n", name, steps,
+         percentile(toSynth, 50), percentile(toSynth, 99),
+         toSynth.empty() ? 0 : *std::max_element(toSynth.begin(), toSynth.end()),
+         percentile(toGlass, 50), percentile(toGlass, 99),
+         toGlass.empty() ? 0 : *std::max_element(toGlass.begin(), toGlass.end()),
+         waitingSynth.size() + waitingGlass.size());
+  return waitingSynth.empty() && waitingGlass.empty() && percentile(toSynth, 99) <= synthBound &&
+         percentile(toGlass, 99) <= glassBound;
+}
+
+int main(int argc, char **argv) {
+  int first = 1;
+  for (; first + 1 < argc; first += 2) {
+    if (!strcmp(argv[first], "--synth99"))
+      synthBound = atof(argv[first + 1]);
+    else if (!strcmp(argv[first], "--glass99"))
+      glassBound = atof(argv[first + 1]);
+    else
+      break;
+  }
+  if (first >= argc) {
+    fprintf(stderr, "usage: ubitx_knob [--synth99 msec] [--glass99 msec] trace...\n");
+    return 2;
+  }
+
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+
+  //the one pin change interrupt of the front panel, as on the Nano
+  attachInterrupt(ENC_A, encoderEdge, CHANGE);
+  attachInterrupt(ENC_B, encoderEdge, CHANGE);
+  attachInterrupt(FBUTTON, encoderEdge, CHANGE);
+  attachInterrupt(PTT, encoderEdge, CHANGE);
+  hostOnSynth([](int clk) {
+    if (clk != 2)
+      return;
+    uint64_t now = hostNanos();
+    for (size_t i = 0; i < waitingSynth.size(); i++) {
+      toSynth.push_back((now - waitingSynth[i]) / 1e6);
+      waitingGlass.push_back(std::make_pair(waitingSynth[i], now));
+    }
+    waitingSynth.clear();
+  });
+
+  printf("%-24s %6s %8s %8s %8s %8s %8s %8s %6s\n", "trace", "steps", "synth50", "synth99",
+         "synthmax", "glass50", "glass99", "glassmax", "lost");
+  int failed = 0;
+  for (int t = first; t < argc; t++) {
+    std::vector<Input> inputs;
+    if (!load(argv[t], inputs) || inputs.empty()) {
+      fprintf(stderr, "%s: can't read the trace\n", argv[t]);
+      failed++;
+      continue;
+    }
+    toSynth.clear();
+    toGlass.clear();
+    waitingSynth.clear();
+    waitingGlass.clear();
+
+    uint64_t start = hostNanos(), end = start;
+    for (size_t i = 0; i < inputs.size(); i++) {
+      schedule(start, inputs[i]);
+      uint64_t last = start + (uint64_t)(inputs[i].ms * HOST_MSEC);
+      if (inputs[i].what == "turn")
+        last += (uint64_t)abs(inputs[i].a) * inputs[i].b * HOST_MSEC;
+      end = std::max(end, last);
+    }
+    //and two seconds more to let the last repaint come
+    end += 2 * HOST_SEC;
+
+    //loop() a pass at a time as hostRun() does, to see each repaint of the vfos
+    hostWatch(VFOA_X, ROW1_Y, VFOB_X + VFO_W, ROW1_Y + VFO_H);
+    uint64_t painted = 0;
+    while (hostNanos() < end) {
+      hostSerialPoll();
+      loop();
+      hostAdvance(hostPassNs);
+      if (hostWatched() != painted) {
+        //a repaint that came before the synthesizer in the same pass still showed the old one
+        painted = hostWatched();
+        std::vector<std::pair<uint64_t, uint64_t>> later;
+        for (size_t i = 0; i < waitingGlass.size(); i++)
+          if (waitingGlass[i].second <= painted)
+            toGlass.push_back((painted - waitingGlass[i].first) / 1e6);
+          else
+            later.push_back(waitingGlass[i]);
+        waitingGlass.swap(later);
+      }
+    }
+
+    const char *name = strrchr(argv[t], '/');
+    if (!report(name ? name + 1 : argv[t], toSynth.size() + waitingSynth.size()))
+      failed++;
+  }
+  return failed ? 1 : 0;
+}
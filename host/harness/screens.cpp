@@ -0,0 +1,160 @@
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include "host.h"
+#include "ubitx.h"
+#include "scratch.h"
+
+/**
+ * What each thing done on the front panel costs the display, and what it leaves on it.
+ *
+ *   ubitx_screens [--golden dir] [--save dir]
+ *
+ * From power up, through the knob, the buttons of the main screen, the PTT, the WPM dialog
+ * and the frequency keypad, one after the other on the same radio. For each the bytes and
+ * the commands that went to the ILI9341 until the screen was quiet again, the pixels
+ * written, how many of the screen's pixels that changed, and the overdraw: the pixels
+ * written with the colour that was already there, and those written more than once.
+ *
+ * Under each step the same traffic by where it came from, the BUS_ sites of ubitx.h as the
+ * D3 command reads them on the radio: the bytes, the times the site was entered, the chip
+ * selects, the pixels and the clock cycles. The sites that weren't used are left out.
+ *
+ * --save writes the screen after each into dir as NN-name.png, --golden compares it pixel
+ * for pixel with those and fails on any difference, for the test. A scratch lease that
+ * didn't fit fails it as well. A change to the screens
+ * that is meant is saved again over the images in host/tests/golden.
+ */
+struct Step {
+  const char *name;
+  void (*run)();
+};
+
+static void quiet() {
+  //until nothing has gone to the display for longer than the hold off of the vfo repaint
+  uint64_t bytes = hostDisplayStats().bytes, since = hostNanos(), limit = hostNanos() + 5 * HOST_SEC;
+  while (hostNanos() - since < 600 * HOST_MSEC && hostNanos() < limit) {
+    hostRun(hostNanos() + 50 * HOST_MSEC);
+    if (hostDisplayStats().bytes != bytes) {
+      bytes = hostDisplayStats().bytes;
+      since = hostNanos();
+    }
+  }
+}
+
+static void tap(int x, int y) {
+  hostTouch(x + BTN_W / 2, y + BTN_H / 2);
+  hostRun(hostNanos() + 150 * HOST_MSEC);
+  hostTouchRelease();
+}
+
+static void turn(int detents) {
+  static const uint8_t cw[4][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+  for (int i = 0; i < detents; i++)
+    for (int j = 0; j < 4; j++) {
+      hostPin(ENC_A, cw[j][0]);
+      hostPin(ENC_B, cw[j][1]);
+      hostRun(hostNanos() + 5 * HOST_MSEC);
+    }
+}
+
+static void button() {
+  hostPin(FBUTTON, LOW);
+  hostRun(hostNanos() + 100 * HOST_MSEC);
+  hostPin(FBUTTON, HIGH);
+}
+
+#if DIAG_BUS
+static const char *busNames[BUS_SITES] = {"other", "quickfill", "char", "address", "pixel", "touch", "si5351"};
+
+static void printBus() {
+  for (int i = 0; i < BUS_SITES; i++)
+    if (busStats[i].bytes || busStats[i].entries)
+      printf("  %-10s %8" PRIu32 " %7u %7u %9" PRIu32 " %9" PRIu32 "\n", busNames[i], busStats[i].bytes,
+             busStats[i].entries, busStats[i].selects, busStats[i].pixels, busStats[i].cycles);
+}
+#endif
+
+static const Step steps[] = {
+  {"boot", hostBoot},
+  {"tune", []() { turn(1); }},
+  {"spin", []() { turn(20); }},
+  {"usb", []() { tap(COL1_X, ROW3_Y); }},
+  {"lsb", []() { tap(COL2_X, ROW3_Y); }},
+  {"cw", []() { tap(COL3_X, ROW3_Y); }},
+  {"cw-off", []() { tap(COL3_X, ROW3_Y); }},
+  {"vfo-b", []() { tap(VFOB_X, ROW1_Y); }},
+  {"vfo-a", []() { tap(VFOA_X, ROW1_Y); }},
+  {"split", []() { tap(COL5_X, ROW3_Y); }},
+  {"split-off", []() { tap(COL5_X, ROW3_Y); }},
+  //before the band, its preset here is CW where the PTT held down is the straight key
+  {"ptt", []() { hostPin(PTT, LOW); }},
+  {"ptt-off", []() { hostPin(PTT, HIGH); }},
+  {"band", []() { tap(COL4_X, ROW4_Y); }},
+  {"band-off", []() { tap(COL4_X, ROW4_Y); }},
+  {"wpm", []() { tap(COL4_X, ROW5_Y); }},
+  {"wpm-done", button},
+  //the keypad over the buttons, and cancelled
+  {"frq", []() { tap(COL3_X, ROW4_Y); }},
+  {"frq-can", []() { tap(COL5_X, ROW5_Y); }},
+};
+
+int main(int argc, char **argv) {
+  const char *golden = NULL, *save = NULL;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--golden"))
+      golden = argv[i + 1];
+    else if (!strcmp(argv[i], "--save"))
+      save = argv[i + 1];
+  }
+
+  hostEepromDefaults();
+
+  printf("%-10s %8s %7s %7s %7s %9s %9s %7s\n", "step", "bytes", "cmds", "pixels", "changed",
+         "unchanged", "rewritten", "golden");
+#if DIAG_BUS
+  printf("  %-10s %8s %7s %7s %9s %9s\n", "site", "bytes", "entries", "selects", "pixels", "cycles");
+#endif
+  int failed = 0;
+  for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+    std::vector<uint16_t> before(hostFrame(), hostFrame() + HOST_SCREEN_W * HOST_SCREEN_H);
+    hostDisplayReset();
+#if DIAG_BUS
+    memset(busStats, 0, sizeof(busStats));
+#endif
+    steps[i].run();
+    quiet();
+
+    struct HostDisplayStats stats = hostDisplayStats();
+    int changed = 0;
+    for (size_t p = 0; p < before.size(); p++)
+      if (before[p] != hostFrame()[p])
+        changed++;
+
+    char file[300], compared[16] = "-";
+    snprintf(file, sizeof(file), "%s/%02zu-%s.png", save ? save : golden ? golden : ".", i, steps[i].name);
+    if (save && !hostSaveScreen(file)) {
+      fprintf(stderr, "%s: can't write it\n", file);
+      failed++;
+    }
+    else if (golden && !save) {
+      int differ = hostCompareScreen(file);
+      if (differ)
+        failed++;
+      if (differ < 0)
+        strcpy(compared, "missing");
+      else
+        snprintf(compared, sizeof(compared), "%d", differ);
+    }
+    printf("%-10s %8" PRIu64 " %7" PRIu64 " %7" PRIu64 " %7d %9" PRIu64 " %9" PRIu64 " %7s\n", steps[i].name,
+           stats.bytes, stats.commands, stats.pixels, changed, stats.unchanged, stats.rewritten, compared);
+#if DIAG_BUS
+    printBus();
+#endif
+  }
+  if (scratchOverflows) {
+    fprintf(stderr, "%d scratch leases didn't fit\n", scratchOverflows);
+    failed++;
+  }
+  return failed ? 1 : 0;
+}
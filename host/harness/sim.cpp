@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * A uBITX without the radio: the sketch on the host build, run at the pace of the wall clock,
+ * with its CAT port on a pseudo terminal for hamlib, WSJT-X or fldigi to open as an FT-817,
+ * and its screen written to an image file every so often.
+ *
+ *   ubitx_sim [--link path] [--screen file.png|.ppm] [--every secs] [--eeprom file]
+ *             [--seconds n] [--speed x]
+ *
+ *   rigctl -m 1020 -r /dev/pts/N -s 38400 f
+ *
+ * The name of the pseudo terminal is printed, --link puts a symlink to it as well. The screen
+ * goes to ubitx.png (ubitx.ppm without zlib) each second by default, through a file
+ * next to it so that a viewer never reads half of one. --eeprom keeps the settings between
+ * runs, without it the radio comes up as if it had been set up. It runs until interrupted,
+ * or for --seconds of its own time; --speed runs its clock faster or slower than the wall's.
+ */
+static volatile sig_atomic_t stop = 0;
+
+static void interrupted(int) {
+  stop = 1;
+}
+
+//through sim.part.png for sim.png, hostSaveScreen() goes by the suffix
+static void saveScreen(const std::string &path) {
+  size_t dot = path.rfind('.');
+  std::string part = dot == std::string::npos || path.find('/', dot) != std::string::npos ?
+                     path + ".part" : path.substr(0, dot) + ".part" + path.substr(dot);
+  if (hostSaveScreen(part.c_str()))
+    rename(part.c_str(), path.c_str());
+}
+
+int main(int argc, char **argv) {
+  const char *link = NULL, *eeprom = NULL;
+#ifdef HOST_PNG
+  std::string screen = "ubitx.png";
+#else
+  std::string screen = "ubitx.ppm";
+#endif
+  double every = 1, seconds = 0, speed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--link"))
+      link = argv[i + 1];
+    else if (!strcmp(argv[i], "--screen"))
+      screen = argv[i + 1];
+    else if (!strcmp(argv[i], "--every"))
+      every = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--eeprom"))
+      eeprom = argv[i + 1];
+    else if (!strcmp(argv[i], "--seconds"))
+      seconds = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--speed"))
+      speed = atof(argv[i + 1]);
+  }
+  if (speed <= 0 || every <= 0) {
+    fprintf(stderr, "ubitx_sim: --speed and --every must be more than 0\n");
+    return 2;
+  }
+
+  //the pseudo terminal, raw so that the answers don't come back as echo
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) || unlockpt(master)) {
+    perror("ubitx_sim: pseudo terminal");
+    return 1;
+  }
+  std::string name = ptsname(master);
+  //held open, or the master reads fail each time a program closes its end
+  int slave = open(name.c_str(), O_RDWR | O_NOCTTY);
+  struct termios raw;
+  if (slave < 0 || tcgetattr(slave, &raw)) {
+    perror(name.c_str());
+    return 1;
+  }
+  cfmakeraw(&raw);
+  cfsetspeed(&raw, B38400);
+  tcsetattr(slave, TCSANOW, &raw);
+  if (link) {
+    unlink(link);
+    if (symlink(name.c_str(), link)) {
+      perror(link);
+      return 1;
+    }
+  }
+  printf("CAT on %s, the screen in %s\n", link ? link : name.c_str(), screen.c_str());
+  fflush(stdout);
+
+  signal(SIGINT, interrupted);
+  signal(SIGTERM, interrupted);
+
+  if (eeprom) {
+    hostEepromFile(eeprom);
+    //a new file is blank, and the radio would open the calibration dialogs
+    if (hostEeprom()[8] == 0xff)
+      hostEepromDefaults();
+  }
+  else
+    hostEepromDefaults();
+  hostSerialFd(master);
+
+  hostBoot();
+
+  //the virtual clock kept to the wall's, a millisecond at a time, ahead of it it sleeps
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  uint64_t begun = hostNanos(), nextScreen = begun;
+  while (!stop && (!seconds || hostNanos() - begun < (uint64_t)(seconds * HOST_SEC))) {
+    uint64_t wall = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    uint64_t due = begun + (uint64_t)(wall * speed);
+    if (hostNanos() >= due) {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+      continue;
+    }
+    hostRun(std::min(due, (uint64_t)(hostNanos() + HOST_MSEC)));
+    if (hostNanos() >= nextScreen) {
+      saveScreen(screen);
+      nextScreen += (uint64_t)(every * HOST_SEC);
+    }
+  }
+  saveScreen(screen);
+
+  printf("%.1f s, %u bytes lost to a full receive buffer\n", (hostNanos() - begun) / 1e9,
+         hostSerialOverruns());
+  if (link)
+    unlink(link);
+  close(slave);
+  close(master);
+  return 0;
+}
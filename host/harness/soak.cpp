@@ -0,0 +1,329 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "host.h"
+#include "ubitx.h"
+#include "scratch.h"
+
+/**
+ * A soak of the whole sketch on the virtual clock: the radios are turned, touched, keyed and
+ * polled at random for days of their time, each in a process of its own, as many at once as
+ * there are cores.
+ *
+ *   ubitx_soak [--radios 8] [--jobs cores] [--hours 24] [--seed 1]
+ *
+ * A radio powers up a few minutes before millis() and the tick count wrap, at a different
+ * point for each. On it, with gaps of seconds between them: spins of the knob, taps on the
+ * screen, presses of the function button, the PTT held, the paddle and the straight key, and
+ * a CAT client as WSJT-X runs one: the frequency read every second, a retune now and then, a
+ * transmit over the PTT command in some of the 15 second periods. The long press into the
+ * setup menu is left out, its calibration moves the oscillators on purpose.
+ *
+ * What must hold all along, a radio stops at the first time it doesn't:
+ *  - it transmits only inside LOWEST_TX_FREQ to HIGHEST_TX_FREQ: whenever TX_RX or CW_KEY
+ *    is high, the carrier from the oscillators, CLK2 less the first IF or CLK2 itself when
+ *    CW has switched CLK1 off, is within the bounds and the sideband's width of them
+ *  - no stuck transmit: once the PTT, the paddle and the CAT client have all let go, inTx
+ *    and txCAT drop within STUCK_MSEC, the CW hang time and more
+ *  - no lost encoder steps: each edge counts in enc_count as the quadrature says it should,
+ *    none are run together (isrStats' missed) or lost to enc_count overflowing
+ *  - every scratch lease fits in the arena (scratchOverflows), the host build stops on
+ *    one that doesn't
+ */
+#define TX_MARGIN 5000        //Hz, the sidetone offset of the carrier and the 3 kHz of the sideband
+#define STUCK_MSEC 5000
+
+static std::mt19937 rng;
+static std::string failure;
+static uint64_t failedAt;
+
+static int64_t expectedSteps = 0, countedSteps = 0;
+static uint64_t spins = 0, touches = 0, presses = 0, ptts = 0, paddles = 0, catTx = 0, transmits = 0;
+
+static bool pttHeld = false, paddleHeld = false, catPtt = false;
+static uint64_t releasedAt = 0;
+
+static void fail(const char *what, double f = 0) {
+  if (!failure.empty())
+    return;
+  char text[160];
+  snprintf(text, sizeof(text), what, f);
+  failure = text;
+  failedAt = hostNanos();
+}
+
+static uint64_t uniform(uint64_t from, uint64_t to) {
+  return std::uniform_int_distribution<uint64_t>(from, to)(rng);
+}
+
+//the gaps between the operator's doings, about mean apart
+static uint64_t gap(uint64_t mean) {
+  return hostNanos() + (uint64_t)std::exponential_distribution<double>(1.0 / mean)(rng) + HOST_MSEC;
+}
+
+/**
+ * The transmit frequency, whenever the oscillators or the TX pins change
+ */
+static void checkTx() {
+  if (hostPinOut(TX_RX) == LOW && hostPinOut(CW_KEY) == LOW)
+    return;
+  //CW puts CLK2 on the carrier and turns CLK1 off, SSB mixes CLK2 down by the first IF
+  double carrier = hostSynth(1) == 0 ? hostSynth(2) : hostSynth(2) - firstIF;
+  if (carrier < LOWEST_TX_FREQ - TX_MARGIN || carrier > HIGHEST_TX_FREQ + TX_MARGIN)
+    fail("transmitting on %.0f Hz", carrier);
+}
+
+/**
+ * The encoder, its interrupt counted around
+ */
+extern int16_t enc_count;          //encoder.cpp
+void enc_interrupt(void);
+
+static void encoderEdge() {
+  int before = enc_count;
+  enc_interrupt();
+  countedSteps += enc_count - before;
+}
+
+static void spin() {
+  //a quadrature cycle per detent, from the rest with both pins high, the middle two edges count
+  static const uint8_t cw[4][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+  static const uint8_t ccw[4][2] = {{1, 0}, {0, 0}, {0, 1}, {1, 1}};
+  int detents = (int)uniform(1, 40);
+  bool up = uniform(0, 1);
+  uint64_t at = hostNanos(), apart = uniform(200, 20000) * HOST_USEC;
+
+  for (int i = 0; i < detents; i++)
+    for (int j = 0; j < 4; j++) {
+      const uint8_t *level = up ? cw[j] : ccw[j];
+      at += apart / 4;
+      int step = j == 1 || j == 2 ? (up ? 1 : -1) : 0;
+      hostAt(at, [level, step]() {
+        expectedSteps += step;
+        hostPin(ENC_A, level[0]);
+        hostPin(ENC_B, level[1]);
+      });
+    }
+  spins++;
+  hostAt(gap(5 * HOST_SEC) + at - hostNanos(), spin);
+}
+
+/**
+ * The screen, the button, the PTT and the paddle
+ */
+static void touch() {
+  hostTouch((int)uniform(0, HOST_SCREEN_W - 1), (int)uniform(0, HOST_SCREEN_H - 1));
+  hostAt(hostNanos() + uniform(50, 400) * HOST_MSEC, hostTouchRelease);
+  touches++;
+  hostAt(gap(20 * HOST_SEC), touch);
+}
+
+static void press() {
+  hostPin(FBUTTON, LOW);
+  hostAt(hostNanos() + uniform(80, 600) * HOST_MSEC, []() { hostPin(FBUTTON, HIGH); });
+  presses++;
+  hostAt(gap(60 * HOST_SEC), press);
+}
+
+static void letGo() {
+  releasedAt = hostNanos();
+}
+
+static void ptt() {
+  uint64_t hold = uniform(300, 15000) * HOST_MSEC;
+  pttHeld = true;
+  hostPin(PTT, LOW);
+  hostAt(hostNanos() + hold, []() {
+    pttHeld = false;
+    hostPin(PTT, HIGH);
+    letGo();
+  });
+  ptts++;
+  hostAt(gap(90 * HOST_SEC) + hold, ptt);
+}
+
+//the readings of ANALOG_KEYER: the straight key, both paddles, the dot and the dash
+static void paddle() {
+  static const int levels[4] = {20, 200, 450, 700};
+  uint64_t at = hostNanos();
+  int elements = (int)uniform(1, 30);
+  paddleHeld = true;
+  for (int i = 0; i < elements; i++) {
+    int level = levels[uniform(0, 3)];
+    hostAt(at, [level]() { hostAnalog(ANALOG_KEYER, level); });
+    at += uniform(20, 400) * HOST_MSEC;
+    hostAt(at, []() { hostAnalog(ANALOG_KEYER, 1023); });
+    at += uniform(20, 300) * HOST_MSEC;
+  }
+  hostAt(at, []() {
+    paddleHeld = false;
+    letGo();
+  });
+  paddles++;
+  hostAt(gap(30 * HOST_SEC) + at - hostNanos(), paddle);
+}
+
+/**
+ * The CAT client: WSJT-X's poll of the frequency each second, and on the 15 second periods
+ * a retune to a dial frequency of FT8, some of them out of the TX bands, or a transmit
+ */
+static void cat(uint8_t p1, uint8_t p2, uint8_t p3, uint8_t p4, uint8_t opcode) {
+  uint8_t frame[5] = {p1, p2, p3, p4, opcode};
+  hostSerialSend(frame, 5);
+}
+
+static void poll() {
+  cat(0, 0, 0, 0, catPtt ? 0xf7 : 0x03);
+  hostAt(hostNanos() + HOST_SEC, poll);
+}
+
+static void period() {
+  static const uint32_t dials[] = {1840000, 3573000, 5357000, 7074000, 10136000, 14074000,
+                                   18100000, 21074000, 24915000, 28074000, 50313000};
+  uint64_t start = hostNanos();
+  switch (uniform(0, 3)) {
+  case 0: {
+    uint32_t f = dials[uniform(0, sizeof(dials) / sizeof(dials[0]) - 1)] / 10;
+    uint8_t bcd[4];
+    for (int i = 3; i >= 0; i--, f /= 100)
+      bcd[i] = ((f / 10 % 10) << 4) | (f % 10);
+    cat(bcd[0], bcd[1], bcd[2], bcd[3], 0x01);
+    break;
+  }
+  case 1:
+    catPtt = true;
+    cat(0, 0, 0, 0, 0x08);
+    hostAt(start + 12600 * HOST_MSEC, []() {
+      cat(0, 0, 0, 0, 0x88);
+      catPtt = false;
+      letGo();
+    });
+    catTx++;
+    break;
+  }
+  hostAt(start + 15 * HOST_SEC, period);
+}
+
+/**
+ * The stuck transmit, looked at ten times a second
+ */
+static void watch() {
+  bool asked = pttHeld || paddleHeld || catPtt;
+  if (asked)
+    releasedAt = hostNanos();
+  else if ((inTx || txCAT) && hostNanos() - releasedAt > STUCK_MSEC * HOST_MSEC)
+    fail(inTx ? "still transmitting %.1f s after the last release" :
+         "txCAT still set %.1f s after the last release", (hostNanos() - releasedAt) / 1e9);
+
+  hostAt(hostNanos() + 100 * HOST_MSEC, watch);
+}
+
+//the encoder's counts so far, with the interrupts on between two passes of loop()
+static void checkSteps() {
+  if (isrStats[ISR_ENCODER].missed)
+    fail("%.0f encoder steps run together", isrStats[ISR_ENCODER].missed);
+  else if (countedSteps != expectedSteps)
+    fail("%.0f encoder steps lost", (double)(expectedSteps - countedSteps));
+}
+
+static int radio(int number, double hours, unsigned seed) {
+  rng.seed(seed + number);
+
+  //up to ten minutes before the wrap
+  uint32_t start = 0xffffffffu - (uint32_t)uniform(10, 600) * 1000;
+  hostMillisStart(start);
+  tick_preset(start);
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+
+  //the one pin change interrupt of the front panel, as on the Nano
+  attachInterrupt(ENC_A, encoderEdge, CHANGE);
+  attachInterrupt(ENC_B, encoderEdge, CHANGE);
+  attachInterrupt(FBUTTON, encoderEdge, CHANGE);
+  attachInterrupt(PTT, encoderEdge, CHANGE);
+  hostOnSynth([](int clk) { checkTx(); });
+  hostOnPin(TX_RX, [](int level) {
+    if (level)
+      transmits++;
+    checkTx();
+  });
+  hostOnPin(CW_KEY, [](int level) { checkTx(); });
+  hostOnSerial([](uint8_t c) {});
+
+  hostAt(gap(5 * HOST_SEC), spin);
+  hostAt(gap(20 * HOST_SEC), touch);
+  hostAt(gap(60 * HOST_SEC), press);
+  hostAt(gap(90 * HOST_SEC), ptt);
+  hostAt(gap(30 * HOST_SEC), paddle);
+  hostAt(hostNanos() + HOST_SEC, poll);
+  hostAt(hostNanos() + 15 * HOST_SEC, period);
+  hostAt(hostNanos() + 100 * HOST_MSEC, watch);
+
+  uint64_t end = hostNanos() + (uint64_t)(hours * 3600 * HOST_SEC);
+  while (failure.empty() && hostNanos() < end) {
+    hostRun(hostNanos() + HOST_SEC);
+    checkSteps();
+    if (scratchOverflows)
+      fail("%.0f scratch leases didn't fit", scratchOverflows);
+  }
+
+  if (!failure.empty()) {
+    printf("radio %d: FAILED at %.3f s: %s\n", number, failedAt / 1e9, failure.c_str());
+    return 1;
+  }
+  printf("radio %d: ok, %.2f h from millis() %" PRIu32 ", %" PRIu64 " spins, %" PRIu64 " touches, %" PRIu64
+         " presses, %" PRIu64 " PTT, %" PRIu64 " paddle, %" PRIu64 " CAT TX, %" PRIu64 " transmits\n", number, hostNanos() / 3600e9, start,
+         spins, touches, presses, ptts, paddles, catTx, transmits);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  int radios = 8, jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  double hours = 24;
+  unsigned seed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--radios"))
+      radios = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--jobs"))
+      jobs = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--hours"))
+      hours = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed"))
+      seed = strtoul(argv[i + 1], NULL, 10);
+  }
+  if (jobs < 1)
+    jobs = 1;
+
+  //a process for each radio, the sketch's globals are its own
+  int running = 0, failed = 0;
+  fflush(stdout);
+  for (int i = 0; i < radios || running; ) {
+    if (i < radios && running < jobs) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        int rc = radio(i, hours, seed);
+        fflush(stdout);
+        _exit(rc);
+      }
+      if (pid < 0) {
+        perror("fork");
+        return 2;
+      }
+      running++;
+      i++;
+      continue;
+    }
+    int status;
+    if (wait(&status) < 0)
+      break;
+    running--;
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+      failed++;
+  }
+  printf("%d of %d radios failed\n", failed, radios);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+#ifndef _HOST_H_
+#define _HOST_H_
+
+/**
+ * What stands in for the Raduino when the sketch is built on Linux, for the tests and the
+ * harnesses in this directory. The sketch runs unchanged on a virtual clock: nothing takes
+ * any time but what the Nano would spend waiting on its hardware, that is the SPI and I2C
+ * transfers at their clock rates, the ADC, the EEPROM writes, the serial port at its baud
+ * rate, delay() and the idle sleep. A pass of loop() costs hostPassNs on top. The clock
+ * only moves when the sketch waits, so a run is the same every time.
+ *
+ * The tick interrupt of timer.cpp comes every millisecond of virtual time, the encoder
+ * interrupt when hostPin() changes a pin it is attached to, and the events of hostAt() at
+ * their time, all in between the sketch's own steps as interrupts would.
+ *
+ * The harnesses include the C++ library they need, then this file and then the sketch's
+ * headers.
+ */
+#include <functional>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+
+//the sketch
+void setup();
+void loop();
+
+/**
+ * The clock, in nanoseconds since power up
+ */
+uint64_t hostNanos();
+void hostAdvance(uint64_t ns);                              //lets the time pass, the interrupts and events come as they are due
+void hostAt(uint64_t ns, std::function<void()> event);      //runs the event at that time, as an interrupt
+void hostBoot();                                            //runs setup()
+void hostRun(uint64_t ns);                                  //runs loop() until the clock has got to this time
+void hostMillisStart(uint32_t ms);                          //what millis() reads at power up, before hostBoot()
+extern uint64_t hostPassNs;                                 //a pass of loop() without the waits, 20 usec
+
+#define HOST_USEC 1000ull
+#define HOST_MSEC 1000000ull
+#define HOST_SEC  1000000000ull
+
+/**
+ * The pins. The inputs start high, as the pull ups leave them
+ */
+void hostPin(uint8_t pin, int level);                       //sets an input, its interrupt runs if it changed
+int hostPinOut(uint8_t pin);                                //what the sketch drives the pin to
+void hostOnPin(uint8_t pin, std::function<void(int level)> changed);  //each time the sketch changes it
+void hostAnalog(uint8_t pin, int value);                    //what analogRead() reads, 0 to 1023
+unsigned int hostTone();                                    //the frequency of the tone() playing, 0 if none
+
+/**
+ * The serial port, the computer's end of it
+ */
+void hostSerialSend(const uint8_t *data, size_t n);         //goes on the wire now, after what is still on it
+std::string hostSerialReceived();                           //what the sketch sent since the last call, once it was on the wire
+void hostOnSerial(std::function<void(uint8_t c)> received); //each byte as it has come off the wire, instead of the above
+void hostSerialFd(int fd);                                  //or a pipe or a pseudo terminal is the computer, -1 for none
+void hostSerialPoll();                                      //sends what can be read from it, hostRun() does on each pass
+unsigned int hostSerialOverruns();                          //bytes lost to a full receive buffer
+
+/**
+ * The display, an ILI9341 in the landscape mode the sketch sets up: CASET takes x, 0 to 319,
+ * and PASET y, 0 to 239. The pixels are RGB565.
+ */
+#define HOST_SCREEN_W 320
+#define HOST_SCREEN_H 240
+
+struct HostDisplayStats {
+  uint64_t bytes;       //everything that went to the display, commands and pixels
+  uint64_t commands;
+  uint64_t pixels;      //pixels written into the frame
+  uint64_t unchanged;   //of those, the ones written with the colour already there
+  uint64_t rewritten;   //written more than once since hostDisplayReset()
+};
+
+uint16_t hostPixel(int x, int y);
+const uint16_t *hostFrame();                                //HOST_SCREEN_H rows of HOST_SCREEN_W pixels
+struct HostDisplayStats hostDisplayStats();
+void hostDisplayReset();                                    //the counts start over
+void hostWatch(int x1, int y1, int x2, int y2);             //keeps the time of the last pixel written in the box
+uint64_t hostWatched();                                     //that time, 0 if none since hostWatch()
+
+bool hostSaveScreen(const char *path);                      //.ppm or .png
+int hostCompareScreen(const char *path);                    //the pixels that differ from the image, -1 if it can't be read
+bool hostLoadImage(const char *path, std::vector<uint16_t> &pixels);
+
+/**
+ * The touch screen, in the XPT2046's own units. hostTouch() takes screen coordinates through
+ * the calibration the sketch has, see scaleTouch()
+ */
+void hostTouchRaw(int x, int y);
+void hostTouchRelease();
+void hostTouch(int x, int y);
+
+/**
+ * The Si5351, from the registers written to it
+ */
+double hostSynth(int clk);                                  //the output frequency in Hz, 0 when it is off
+void hostOnSynth(std::function<void(int clk)> changed);     //after a transmission that changed a clock
+void hostI2cFail(uint8_t status);                           //what endTransmission() returns from now on, 0 to succeed
+
+/**
+ * The EEPROM, 0xff all over until something is written
+ */
+void hostEepromFile(const char *path);                      //kept in this file, read from it if it is there
+uint8_t *hostEeprom();
+void hostEepromDefaults();                                  //the settings of a radio that has been set up, without the calibration dialogs
+
+//from timer.cpp, starts the tick count there instead of 0, to get to its wrap sooner
+void tick_preset(uint32_t ms);
+
+#endif
@@ -0,0 +1,200 @@
+#include <vector>
+#ifdef HOST_PNG
+#include <zlib.h>
+#endif
+#include "host.h"
+
+/**
+ * The screen as an image file: a binary PPM always, a PNG when zlib is there (HOST_PNG).
+ * Both are 8 bit RGB, the RGB565 of the display spread out so that it comes back the same.
+ * Only PNGs as written here are read back, 8 bit RGB without interlacing.
+ */
+static bool endsWith(const char *path, const char *suffix) {
+  size_t n = strlen(path), m = strlen(suffix);
+  return n >= m && !strcmp(path + n - m, suffix);
+}
+
+static void rgb(uint16_t c, uint8_t *p) {
+  p[0] = (c >> 11) * 255 / 31;
+  p[1] = ((c >> 5) & 0x3f) * 255 / 63;
+  p[2] = (c & 0x1f) * 255 / 31;
+}
+
+static uint16_t rgb565(const uint8_t *p) {
+  return ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+}
+
+#ifdef HOST_PNG
+static void chunk(FILE *f, const char *type, const std::vector<uint8_t> &data) {
+  uint8_t length[4] = {(uint8_t)(data.size() >> 24), (uint8_t)(data.size() >> 16),
+                       (uint8_t)(data.size() >> 8), (uint8_t)data.size()};
+  uint32_t crc = crc32(0, (const Bytef *)type, 4);
+  if (!data.empty())
+    crc = crc32(crc, data.data(), data.size());
+  uint8_t check[4] = {(uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc};
+  fwrite(length, 1, 4, f);
+  fwrite(type, 1, 4, f);
+  fwrite(data.data(), 1, data.size(), f);
+  fwrite(check, 1, 4, f);
+}
+
+static bool savePng(FILE *f) {
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  std::vector<uint8_t> header = {0, 0, HOST_SCREEN_W >> 8, HOST_SCREEN_W & 0xff,
+                                 0, 0, 0, HOST_SCREEN_H, 8, 2, 0, 0, 0};
+
+  //each row starts with its filter, none
+  std::vector<uint8_t> raw;
+  for (int y = 0; y < HOST_SCREEN_H; y++) {
+    raw.push_back(0);
+    for (int x = 0; x < HOST_SCREEN_W; x++) {
+      uint8_t p[3];
+      rgb(hostPixel(x, y), p);
+      raw.insert(raw.end(), p, p + 3);
+    }
+  }
+  uLongf size = compressBound(raw.size());
+  std::vector<uint8_t> packed(size);
+  if (compress2(packed.data(), &size, raw.data(), raw.size(), 9) != Z_OK)
+    return false;
+  packed.resize(size);
+
+  fwrite(signature, 1, 8, f);
+  chunk(f, "IHDR", header);
+  chunk(f, "IDAT", packed);
+  chunk(f, "IEND", std::vector<uint8_t>());
+  return true;
+}
+
+static uint32_t be32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int paeth(int a, int b, int c) {
+  int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+static bool loadPng(const std::vector<uint8_t> &file, int &w, int &h, std::vector<uint8_t> &pixels) {
+  std::vector<uint8_t> packed;
+  size_t at = 8;
+  if (file.size() < 8 || memcmp(file.data(), "\x89PNG", 4))
+    return false;
+
+  while (at + 12 <= file.size()) {
+    uint32_t n = be32(&file[at]);
+    const uint8_t *type = &file[at + 4], *data = &file[at + 8];
+    if (at + 12 + n > file.size())
+      return false;
+    if (!memcmp(type, "IHDR", 4)) {
+      w = be32(data);
+      h = be32(data + 4);
+      if (data[8] != 8 || data[9] != 2 || data[12] != 0)
+        return false;
+    }
+    else if (!memcmp(type, "IDAT", 4))
+      packed.insert(packed.end(), data, data + n);
+    at += 12 + n;
+  }
+
+  size_t stride = (size_t)w * 3;
+  std::vector<uint8_t> raw((stride + 1) * h);
+  uLongf size = raw.size();
+  if (uncompress(raw.data(), &size, packed.data(), packed.size()) != Z_OK || size != raw.size())
+    return false;
+
+  pixels.assign(stride * h, 0);
+  for (int y = 0; y < h; y++) {
+    uint8_t filter = raw[y * (stride + 1)];
+    const uint8_t *in = &raw[y * (stride + 1) + 1];
+    uint8_t *out = &pixels[y * stride];
+    const uint8_t *up = y ? out - stride : NULL;
+    for (size_t i = 0; i < stride; i++) {
+      int a = i >= 3 ? out[i - 3] : 0, b = up ? up[i] : 0, c = up && i >= 3 ? up[i - 3] : 0;
+      int predicted = filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2 :
+                      filter == 4 ? paeth(a, b, c) : 0;
+      out[i] = in[i] + predicted;
+    }
+  }
+  return true;
+}
+#endif
+
+static bool loadPpm(const std::vector<uint8_t> &file, int &w, int &h, std::vector<uint8_t> &pixels) {
+  int depth, used = 0;
+  std::string text(file.begin(), file.begin() + (file.size() < 64 ? file.size() : 64));
+  if (sscanf(text.c_str(), "P6 %d %d %d%n", &w, &h, &depth, &used) != 3 || depth != 255)
+    return false;
+  used++;   //the one white space after the header
+  if (file.size() < used + (size_t)w * h * 3)
+    return false;
+  pixels.assign(file.begin() + used, file.begin() + used + (size_t)w * h * 3);
+  return true;
+}
+
+bool hostSaveScreen(const char *path) {
+  FILE *f = fopen(path, "wb");
+  bool saved = f != NULL;
+  if (!f)
+    return false;
+
+  if (endsWith(path, ".png")) {
+#ifdef HOST_PNG
+    saved = savePng(f);
+#else
+    saved = false;
+#endif
+  }
+  else {
+    fprintf(f, "P6\n%d %d\n255\n", HOST_SCREEN_W, HOST_SCREEN_H);
+    for (int y = 0; y < HOST_SCREEN_H; y++)
+      for (int x = 0; x < HOST_SCREEN_W; x++) {
+        uint8_t p[3];
+        rgb(hostPixel(x, y), p);
+        fwrite(p, 1, 3, f);
+      }
+  }
+  fclose(f);
+  return saved;
+}
+
+bool hostLoadImage(const char *path, std::vector<uint16_t> &pixels) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+  std::vector<uint8_t> file;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    file.insert(file.end(), buf, buf + n);
+  fclose(f);
+
+  int w = 0, h = 0;
+  std::vector<uint8_t> data;
+  bool loaded = false;
+  if (file.size() > 2 && file[0] == 'P' && file[1] == '6')
+    loaded = loadPpm(file, w, h, data);
+#ifdef HOST_PNG
+  else
+    loaded = loadPng(file, w, h, data);
+#endif
+  if (!loaded || w != HOST_SCREEN_W || h != HOST_SCREEN_H)
+    return false;
+
+  pixels.resize((size_t)w * h);
+  for (size_t i = 0; i < pixels.size(); i++)
+    pixels[i] = rgb565(&data[i * 3]);
+  return true;
+}
+
+int hostCompareScreen(const char *path) {
+  std::vector<uint16_t> pixels;
+  if (!hostLoadImage(path, pixels))
+    return -1;
+  const uint16_t *screen = hostFrame();
+  int differ = 0;
+  for (size_t i = 0; i < pixels.size(); i++)
+    if (pixels[i] != screen[i])
+      differ++;
+  return differ;
+}
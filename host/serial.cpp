@@ -0,0 +1,139 @@
+#include <deque>
+#include <unistd.h>
+#include <fcntl.h>
+#include "host.h"
+
+/**
+ * The serial port, a byte is 10 bits on the wire at the baud rate. Both ways have the 64 byte
+ * buffers of the HardwareSerial: a byte that arrives with the receive buffer full is lost, a
+ * write with the transmit buffer full waits until a byte has gone out.
+ *
+ * The computer's end is the harness, or a pipe or a pseudo terminal given to hostSerialFd():
+ * what can be read from it is sent on each pass of hostRun(), what the sketch sends is written
+ * to it as it comes off the wire.
+ */
+#define SERIAL_BUFFER 64
+
+HardwareSerial Serial;
+
+static uint64_t byteNs = 10 * HOST_SEC / 9600;
+static std::deque<uint8_t> rx;
+static uint64_t rxFree = 0;         //when the wire from the computer is free for the next byte
+static uint64_t txFree = 0;         //and the wire to it
+static unsigned int txPending = 0;  //written and not gone out yet
+static unsigned int overruns = 0;
+static std::string received;
+static std::function<void(uint8_t c)> receiver;
+static int port = -1;
+
+void HardwareSerial::begin(uint64_t baud) {
+  byteNs = 10 * HOST_SEC / baud;
+}
+
+int HardwareSerial::available() {
+  hostAdvance(HOST_USEC / 2);
+  return rx.size();
+}
+
+int HardwareSerial::peek() {
+  return rx.empty() ? -1 : rx.front();
+}
+
+int HardwareSerial::read() {
+  if (rx.empty())
+    return -1;
+  uint8_t c = rx.front();
+  rx.pop_front();
+  return c;
+}
+
+void HardwareSerial::flush() {
+  if (txPending && txFree > hostNanos())
+    hostAdvance(txFree - hostNanos());
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  //the buffer is full, wait for the byte on the wire to finish, an interrupt can't wait
+  while (txPending >= SERIAL_BUFFER) {
+    uint64_t before = hostNanos();
+    hostAdvance(byteNs);
+    if (hostNanos() == before)
+      break;
+  }
+
+  uint64_t gone = (txFree > hostNanos() ? txFree : hostNanos()) + byteNs;
+  txFree = gone;
+  txPending++;
+  hostAt(gone, [c]() {
+    txPending--;
+    if (port >= 0) {
+      ssize_t n = ::write(port, &c, 1);
+      (void)n;
+    }
+    else if (receiver)
+      receiver(c);
+    else
+      received += (char)c;
+  });
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    write(data[i]);
+  return n;
+}
+
+size_t HardwareSerial::print(int64_t n, int base) {
+  char text[68];
+  if (base == DEC && n < 0)
+    return print(ltoa(n, text, base));
+  return print(ultoa((uint64_t)n, text, base));
+}
+
+size_t HardwareSerial::print(uint64_t n, int base) {
+  char text[68];
+  return print(ultoa(n, text, base));
+}
+
+void hostSerialSend(const uint8_t *data, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    uint8_t c = data[i];
+    rxFree = (rxFree > hostNanos() ? rxFree : hostNanos()) + byteNs;
+    hostAt(rxFree, [c]() {
+      if (rx.size() >= SERIAL_BUFFER)
+        overruns++;
+      else
+        rx.push_back(c);
+    });
+  }
+}
+
+std::string hostSerialReceived() {
+  std::string text;
+  text.swap(received);
+  return text;
+}
+
+void hostOnSerial(std::function<void(uint8_t c)> received) {
+  receiver = received;
+}
+
+void hostSerialFd(int fd) {
+  port = fd;
+  if (fd >= 0)
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void hostSerialPoll() {
+  uint8_t buf[64];
+  if (port < 0)
+    return;
+  ssize_t n = ::read(port, buf, sizeof(buf));
+  if (n > 0)
+    hostSerialSend(buf, n);
+}
+
+unsigned int hostSerialOverruns() {
+  return overruns;
+}
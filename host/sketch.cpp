@@ -0,0 +1,10 @@
+//the sketch itself, with the Arduino.h the IDE puts in front of it. The other sources of the
+//directory are built next to it, see CMakeLists.txt
+#include <Arduino.h>
+#include "../ubitx_v6.1_code.ino"
+
+//a scratch lease that doesn't fit stops a test or a harness, see scratch.h
+void scratchOverflow(byte size, byte used) {
+  fprintf(stderr, "scratch: a lease of %d bytes with %d of %d in use\n", size, used, SCRATCH_SIZE);
+  abort();
+}
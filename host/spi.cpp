@@ -0,0 +1,211 @@
+#include "host.h"
+#include <SPI.h>
+
+/**
+ * The SPI port and the two chips on it.
+ *
+ * The ILI9341 takes a command byte with its D/C pin low and the parameters after it with the
+ * pin high. Only the commands that put pixels in its memory matter here: CASET and PASET set
+ * the window, RAMWR starts writing it at its top left corner and RAMWRC carries on where the
+ * last write stopped, a row at a time. A pixel is two bytes, the high one first.
+ *
+ * The XPT2046 answers a control byte, the one with the top bit set, with a 12 bit conversion
+ * over the next 16 clocks: shifted left by 3, as touch_update() expects it.
+ */
+#define TFT_CS 10
+#define TFT_RS 9
+#define TOUCH_CS 8
+
+SPIClass SPI;
+
+static uint64_t byteNs = 8 * HOST_SEC / 4000000;
+
+/**
+ * The display
+ */
+static uint16_t frame[HOST_SCREEN_H][HOST_SCREEN_W];
+static uint8_t written[HOST_SCREEN_H][HOST_SCREEN_W];   //since hostDisplayReset(), for the overdraw
+static struct HostDisplayStats stats;
+static int watchX1 = 0, watchY1 = 0, watchX2 = -1, watchY2 = -1;
+static uint64_t watched;
+
+static uint8_t command;
+static int parameter;           //the bytes after the command so far
+static uint16_t columnStart, columnEnd, pageStart, pageEnd;
+static int x, y;
+static uint8_t pixelHi;
+
+static void pixel(uint16_t color) {
+  if (x < HOST_SCREEN_W && y < HOST_SCREEN_H && x <= columnEnd && y <= pageEnd) {
+    stats.pixels++;
+    if (frame[y][x] == color)
+      stats.unchanged++;
+    if (written[y][x])
+      stats.rewritten++;
+    written[y][x] = 1;
+    frame[y][x] = color;
+    if (x >= watchX1 && x <= watchX2 && y >= watchY1 && y <= watchY2)
+      watched = hostNanos();
+  }
+
+  //on along the row, then to the start of the next one
+  if (++x > columnEnd) {
+    x = columnStart;
+    if (++y > pageEnd)
+      y = pageStart;
+  }
+}
+
+static void display(uint8_t data) {
+  stats.bytes++;
+  if (hostPinOut(TFT_RS) == LOW) {
+    command = data;
+    parameter = 0;
+    stats.commands++;
+    if (command == 0x2c) {
+      x = columnStart;
+      y = pageStart;
+    }
+    return;
+  }
+
+  switch (command) {
+  case 0x2a:
+    if (parameter < 4) {
+      uint16_t *edge = parameter < 2 ? &columnStart : &columnEnd;
+      *edge = parameter & 1 ? (*edge & 0xff00) | data : (data << 8) | (*edge & 0xff);
+    }
+    break;
+  case 0x2b:
+    if (parameter < 4) {
+      uint16_t *edge = parameter < 2 ? &pageStart : &pageEnd;
+      *edge = parameter & 1 ? (*edge & 0xff00) | data : (data << 8) | (*edge & 0xff);
+    }
+    break;
+  case 0x2c:
+  case 0x3c:
+    if (parameter & 1)
+      pixel((pixelHi << 8) | data);
+    else
+      pixelHi = data;
+    break;
+  }
+  parameter++;
+}
+
+uint16_t hostPixel(int px, int py) {
+  if (px < 0 || px >= HOST_SCREEN_W || py < 0 || py >= HOST_SCREEN_H)
+    return 0;
+  return frame[py][px];
+}
+
+const uint16_t *hostFrame() {
+  return &frame[0][0];
+}
+
+struct HostDisplayStats hostDisplayStats() {
+  return stats;
+}
+
+void hostDisplayReset() {
+  memset(&stats, 0, sizeof(stats));
+  memset(written, 0, sizeof(written));
+}
+
+void hostWatch(int x1, int y1, int x2, int y2) {
+  watchX1 = x1;
+  watchY1 = y1;
+  watchX2 = x2;
+  watchY2 = y2;
+  watched = 0;
+}
+
+uint64_t hostWatched() {
+  return watched;
+}
+
+/**
+ * The touch controller
+ */
+static int touchX, touchY;
+static bool touched = false;
+static uint32_t shift;
+extern int slope_x, slope_y, offset_x, offset_y;   //the calibration, nano_gui.cpp
+
+static uint16_t conversion(uint8_t control) {
+  switch ((control >> 4) & 7) {
+  case 1:
+    return touched ? touchX : 0;
+  case 5:
+    return touched ? touchY : 0;
+  case 3:
+    return touched ? 600 : 0;         //Z1 and Z2 of a firm press
+  case 4:
+    return touched ? 3000 : 4095;
+  }
+  return 0;
+}
+
+static uint8_t touch(uint8_t data) {
+  uint8_t out = shift >> 8;
+  shift = (shift << 8) & 0xffff;
+  if (data & 0x80)
+    shift = conversion(data) << 3;
+  return out;
+}
+
+void hostTouchRaw(int rawX, int rawY) {
+  touchX = rawX;
+  touchY = rawY;
+  touched = true;
+}
+
+void hostTouchRelease() {
+  touched = false;
+}
+
+//scaleTouch() backwards, rounded up so that it gets to the same point again
+static int unscale(int screen, int slope, int offset) {
+  return offset + (screen * slope + 9) / 10;
+}
+
+void hostTouch(int sx, int sy) {
+  hostTouchRaw(unscale(sx, slope_x, offset_x), unscale(sy, slope_y, offset_y));
+}
+
+/**
+ * The port
+ */
+void SPIClass::begin() {
+}
+
+void SPIClass::setClockDivider(uint8_t divider) {
+  static const uint8_t dividers[8] = {4, 16, 64, 128, 2, 8, 32, 64};
+  byteNs = 8 * HOST_SEC / (F_CPU / dividers[divider & 7]);
+}
+
+//the clock stays at what the transaction set after it, as with the Arduino library
+void SPIClass::beginTransaction(SPISettings settings) {
+  byteNs = 8 * HOST_SEC / settings.clock;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  //and a few cycles to load and read the data register
+  hostAdvance(byteNs + 250);
+  if (hostPinOut(TFT_CS) == LOW)
+    display(data);
+  else if (hostPinOut(TOUCH_CS) == LOW)
+    return touch(data);
+  return 0;
+}
+
+uint16_t SPIClass::transfer16(uint16_t data) {
+  uint16_t hi = transfer(data >> 8);
+  return (hi << 8) | transfer(data & 0xff);
+}
+
+void SPIClass::transfer(void *buf, size_t count) {
+  uint8_t *p = (uint8_t *)buf;
+  for (size_t i = 0; i < count; i++)
+    p[i] = transfer(p[i]);
+}
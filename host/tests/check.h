@@ -0,0 +1,26 @@
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+/**
+ * The tests stop at the first check that fails, with where it was and what was expected.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+      fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #condition); \
+      exit(1); \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) do { \
+    int64_t checkA = (int64_t)(a), checkB = (int64_t)(b); \
+    if (checkA != checkB) { \
+      fprintf(stderr, "%s:%d: failed: %s == %s, %" PRId64 " against %" PRId64 "\n", __FILE__, __LINE__, #a, #b, checkA, checkB); \
+      exit(1); \
+    } \
+  } while (0)
+
+#endif
@@ -0,0 +1,33 @@
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * The BCD conversions of bcd.cpp against printf
+ */
+static uint32_t decimal(uint32_t n) {
+  char text[12];
+  snprintf(text, sizeof(text), "%u", n);
+  return strtoul(text, NULL, 16);
+}
+
+int main() {
+  static const uint32_t values[] = {0, 1, 9, 10, 99, 100, 500, 1000, 9999, 7285000, 14285000, 45005000, 99999999};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    CHECK_EQ(bcdFromBinary(values[i]), decimal(values[i]));
+    CHECK_EQ(bcdFrequency(values[i]), decimal(values[i]));
+  }
+
+  for (uint32_t a = 7000000; a < 7001000; a += 37)
+    for (uint32_t step = 0; step < 10000; step += 499) {
+      CHECK_EQ(bcdAdd(decimal(a), decimal(step)), decimal(a + step));
+      CHECK_EQ(bcdSubtract(decimal(a), decimal(step)), decimal(a - step));
+    }
+
+  char text[12];
+  formatFreq(14285000, text);
+  CHECK(!strcmp(text, "14285.00"));
+  formatFreq(475000, text);
+  CHECK(!strcmp(text, "  475.00"));
+  return 0;
+}
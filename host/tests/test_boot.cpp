@@ -0,0 +1,27 @@
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * A radio that has been set up comes up on VFO A with the main screen painted
+ */
+int main() {
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+
+  CHECK_EQ(frequency, 7285000);
+  CHECK_EQ(hostPinOut(TX_RX), LOW);
+  CHECK(fabs(hostSynth(2) - (firstIF + frequency)) < 10);
+  CHECK(hostSynth(0) > 0);
+
+  //the screen is painted, not left at the black it starts with
+  struct HostDisplayStats stats = hostDisplayStats();
+  CHECK(stats.pixels >= HOST_SCREEN_W * HOST_SCREEN_H);
+  int black = 0;
+  for (int i = 0; i < HOST_SCREEN_W * HOST_SCREEN_H; i++)
+    if (!hostFrame()[i])
+      black++;
+  CHECK(black < HOST_SCREEN_W * HOST_SCREEN_H / 2);
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <sys/socket.h>
+#include <unistd.h>
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * The FT-817 commands over the serial port: read the frequency, tune and change the sideband
+ */
+static std::string command(uint8_t p1, uint8_t p2, uint8_t p3, uint8_t p4, uint8_t opcode) {
+  uint8_t frame[5] = {p1, p2, p3, p4, opcode};
+  hostSerialSend(frame, 5);
+  hostRun(hostNanos() + 100 * HOST_MSEC);
+  return hostSerialReceived();
+}
+
+int main() {
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+  hostSerialReceived();
+
+  //7.285 MHz in BCD and LSB
+  std::string answer = command(0, 0, 0, 0, 0x03);
+  CHECK_EQ(answer.size(), 5);
+  CHECK_EQ((uint8_t)answer[0], 0x00);
+  CHECK_EQ((uint8_t)answer[1], 0x72);
+  CHECK_EQ((uint8_t)answer[2], 0x85);
+  CHECK_EQ((uint8_t)answer[3], 0x00);
+  CHECK_EQ((uint8_t)answer[4], 0x00);
+
+  answer = command(0x01, 0x42, 0x00, 0x00, 0x01);
+  CHECK_EQ(answer.size(), 1);
+  CHECK_EQ(frequency, 14200000);
+  CHECK(fabs(hostSynth(2) - (firstIF + frequency)) < 10);
+
+  answer = command(0x01, 0, 0, 0, 0x07);
+  CHECK_EQ(answer.size(), 1);
+  CHECK(isUSB);
+
+  //a frame cut short is dropped and the next one still understood
+  uint8_t part[2] = {0, 0};
+  hostSerialSend(part, 2);
+  hostRun(hostNanos() + 2 * HOST_SEC);
+  answer = command(0, 0, 0, 0, 0x03);
+  CHECK_EQ(answer.size(), 5);
+  CHECK_EQ((uint8_t)answer[1], 0x42);
+  CHECK_EQ((uint8_t)answer[4], 0x01);
+  CHECK_EQ(hostSerialOverruns(), 0);
+
+  //the same over a socket, as a program on the other end of a pseudo terminal would have it
+  int ends[2];
+  CHECK(!socketpair(AF_UNIX, SOCK_STREAM, 0, ends));
+  hostSerialFd(ends[0]);
+  uint8_t getFreq[5] = {0, 0, 0, 0, 0x03};
+  CHECK_EQ(write(ends[1], getFreq, 5), 5);
+  hostRun(hostNanos() + 100 * HOST_MSEC);
+  uint8_t reply[8];
+  CHECK_EQ(read(ends[1], reply, sizeof(reply)), 5);
+  CHECK_EQ(reply[1], 0x42);
+  return 0;
+}
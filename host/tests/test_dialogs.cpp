@@ -0,0 +1,83 @@
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+#include "nano_gui.h"
+
+/**
+ * The PTT keys only once the dialog is closed: the WPM dialog closes on it and then
+ * transmits, the command menu keeps it off. The touch calibration runs as a dialog too,
+ * CAT is answered all through it
+ */
+extern int slope_x, slope_y, offset_x, offset_y;   //nano_gui.cpp
+
+static bool calibrated;
+
+static void tap(int x, int y) {
+  hostTouch(x + BTN_W / 2, y + BTN_H / 2);
+  hostRun(hostNanos() + 150 * HOST_MSEC);
+  hostTouchRelease();
+  hostRun(hostNanos() + 300 * HOST_MSEC);
+}
+
+static void touchCross(int x, int y) {
+  hostTouch(x, y);
+  hostRun(hostNanos() + 200 * HOST_MSEC);
+  hostTouchRelease();
+  hostRun(hostNanos() + 1200 * HOST_MSEC);
+}
+
+int main() {
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+
+  //the WPM dialog takes the PTT as done, and the transmit follows
+  tap(COL4_X, ROW5_Y);
+  CHECK(dialogStep != NULL);
+  hostPin(PTT, LOW);
+  hostRun(hostNanos() + 600 * HOST_MSEC);
+  CHECK(dialogStep == NULL);
+  CHECK(inTx);
+  CHECK_EQ(hostPinOut(TX_RX), HIGH);
+  hostPin(PTT, HIGH);
+  hostRun(hostNanos() + HOST_SEC);
+  CHECK(!inTx);
+
+  //the command menu doesn't, the PTT does nothing while it is open
+  hostPin(FBUTTON, LOW);
+  hostRun(hostNanos() + 100 * HOST_MSEC);
+  hostPin(FBUTTON, HIGH);
+  hostRun(hostNanos() + 300 * HOST_MSEC);
+  CHECK(dialogStep != NULL);
+  hostPin(PTT, LOW);
+  hostRun(hostNanos() + 500 * HOST_MSEC);
+  CHECK(dialogStep != NULL);
+  CHECK(!inTx);
+  CHECK_EQ(hostPinOut(TX_RX), LOW);
+  hostPin(PTT, HIGH);
+  hostRun(hostNanos() + 300 * HOST_MSEC);
+
+  //the touch calibration, with CAT polled in the middle of it
+  int slopeX = slope_x, slopeY = slope_y, offsetX = offset_x, offsetY = offset_y;
+  dialogClose();
+  setupTouch([]() { calibrated = true; });
+  hostRun(hostNanos() + 200 * HOST_MSEC);
+  touchCross(20, 20);
+  touchCross(300, 20);
+  hostSerialReceived();
+  static const uint8_t poll[5] = {0, 0, 0, 0, 0x03};
+  hostSerialSend(poll, 5);
+  hostRun(hostNanos() + 100 * HOST_MSEC);
+  CHECK_EQ(hostSerialReceived().size(), 5);
+  CHECK(!calibrated);
+  touchCross(20, 220);
+  touchCross(300, 220);
+  CHECK(calibrated);
+  CHECK(dialogStep == NULL);
+  //the same calibration back, the crosses were touched where it puts them
+  CHECK(abs(slope_x - slopeX) <= 1);
+  CHECK(abs(slope_y - slopeY) <= 1);
+  CHECK(abs(offset_x - offsetX) <= 2);
+  CHECK(abs(offset_y - offsetY) <= 2);
+  return 0;
+}
@@ -0,0 +1,43 @@
+#include <unistd.h>
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+#include <EEPROM.h>
+
+/**
+ * The EEPROM writes through to its file and takes its time, the settings come back from it
+ */
+int main() {
+  char path[] = "/tmp/ubitx_eepromXXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+
+  hostEepromFile(path);
+  CHECK_EQ(EEPROM.read(VFO_A), 0xff);
+  uint64_t before = hostNanos();
+  uint32_t vfo = 14074000;
+  EEPROM.put(VFO_A, vfo);
+  CHECK(hostNanos() - before >= 4 * 3400 * HOST_USEC);
+  //the same again is not written
+  before = hostNanos();
+  EEPROM.put(VFO_A, vfo);
+  CHECK(hostNanos() - before < 3400 * HOST_USEC);
+
+  FILE *f = fopen(path, "rb");
+  CHECK(f);
+  uint8_t saved[EEPROM_SIZE];
+  CHECK_EQ(fread(saved, 1, sizeof(saved), f), EEPROM_SIZE);
+  fclose(f);
+  CHECK(!memcmp(saved + VFO_A, &vfo, sizeof(vfo)));
+  CHECK_EQ(saved[VFO_B], 0xff);
+
+  //a radio started on it tunes to what was saved
+  hostEepromDefaults();
+  hostEepromFile(path);
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+  CHECK_EQ(frequency, 14074000);
+  unlink(path);
+  return 0;
+}
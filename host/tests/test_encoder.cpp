@@ -0,0 +1,39 @@
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * Turning the knob through the pin change interrupts tunes the radio and redraws the vfo
+ */
+static void turn(int detents, uint64_t apart) {
+  //A and B through one quadrature cycle, from the rest with both pulled up and back
+  static const uint8_t cw[4][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+  static const uint8_t ccw[4][2] = {{1, 0}, {0, 0}, {0, 1}, {1, 1}};
+  for (int i = 0; i < abs(detents); i++)
+    for (int j = 0; j < 4; j++) {
+      const uint8_t *level = detents > 0 ? cw[j] : ccw[j];
+      hostPin(ENC_A, level[0]);
+      hostPin(ENC_B, level[1]);
+      hostRun(hostNanos() + apart / 4);
+    }
+}
+
+int main() {
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+  uint32_t start = frequency;
+
+  hostWatch(VFOA_X, ROW1_Y, VFOA_X + VFO_W, ROW1_Y + VFO_H);
+  turn(10, 40 * HOST_MSEC);
+  hostRun(hostNanos() + HOST_SEC);
+  CHECK(frequency > start);
+  CHECK(fabs(hostSynth(2) - (firstIF + frequency)) < 10);
+  CHECK(hostWatched() > 0);
+
+  uint32_t up = frequency;
+  turn(-10, 40 * HOST_MSEC);
+  hostRun(hostNanos() + HOST_SEC);
+  CHECK(frequency < up);
+  return 0;
+}
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# ubitx_sim as hamlib would use it: the FT-817 commands over its pseudo terminal, the time of
+# each answer on the wall clock, and the screen file it keeps. With rigctl installed, rigctl
+# itself reads the frequency too.
+#   test_sim.py path/to/ubitx_sim
+import os
+import select
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import termios
+import time
+import tty
+
+
+def command(port, frame, answer, timeout=1.0):
+    """sends the 5 bytes, returns the answer and how long it took in msec"""
+    sent = time.time()
+    os.write(port, bytes(frame))
+    got = b''
+    while len(got) < answer:
+        ready, _, _ = select.select([port], [], [], timeout - (time.time() - sent))
+        if not ready:
+            break
+        got += os.read(port, answer - len(got))
+    return got, (time.time() - sent) * 1000
+
+
+def main():
+    workdir = tempfile.mkdtemp()
+    screen = os.path.join(workdir, 'screen.ppm')
+    sim = subprocess.Popen([sys.argv[1], '--screen', screen, '--seconds', '30'],
+                           stdout=subprocess.PIPE, universal_newlines=True)
+    failed = []
+    try:
+        line = sim.stdout.readline()
+        name = line.split()[2].rstrip(',')
+        port = os.open(name, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(port)
+        termios.tcflush(port, termios.TCIOFLUSH)
+        time.sleep(2)   # the start up, as after the reset of opening the Nano's port
+
+        # 7.285 MHz LSB, as hostEepromDefaults() leaves it
+        got, ms = command(port, [0, 0, 0, 0, 0x03], 5)
+        if got != bytes([0x00, 0x72, 0x85, 0x00, 0x00]):
+            failed.append('get freq answered %s' % got.hex())
+        got, ms = command(port, [0x01, 0x40, 0x74, 0x00, 0x01], 1)
+        if got != b'\x00':
+            failed.append('set freq answered %s' % got.hex())
+        got, ms = command(port, [0, 0, 0, 0, 0x03], 5)
+        if got[:4] != bytes([0x01, 0x40, 0x74, 0x00]):
+            failed.append('get freq after the retune answered %s' % got.hex())
+
+        # the answer times end to end, and how many commands a second that makes
+        times = []
+        start = time.time()
+        for i in range(50):
+            got, ms = command(port, [0, 0, 0, 0, 0x03], 5)
+            if len(got) == 5:
+                times.append(ms)
+        took = time.time() - start
+        if len(times) < 50:
+            failed.append('%d of 50 polls unanswered' % (50 - len(times)))
+        elif times:
+            times.sort()
+            print('get freq: p50 %.1f ms, p99 %.1f ms, %.0f commands/s' %
+                  (times[len(times) // 2], times[-1], len(times) / took))
+
+        if shutil.which('rigctl'):
+            out = subprocess.run(['rigctl', '-m', '1020', '-r', name, '-s', '38400', 'f'],
+                                 stdout=subprocess.PIPE, universal_newlines=True, timeout=20)
+            if out.stdout.split()[:1] != ['14074000']:
+                failed.append('rigctl read %r' % out.stdout)
+        os.close(port)
+
+        # the screen is rewritten each second
+        time.sleep(1.5)
+        with open(screen, 'rb') as f:
+            if f.read(2) != b'P6':
+                failed.append('no screen in %s' % screen)
+    finally:
+        sim.send_signal(signal.SIGTERM)
+        sim.wait(timeout=10)
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    for failure in failed:
+        print('FAILED: %s' % failure)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,36 @@
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * The software timers keep working when the tick count wraps around after 49 days
+ */
+int main() {
+  tick_preset(0xffffffff - 50);
+  CHECK(!timerExpired(TIMER_CAT_RX));
+
+  timerStart(TIMER_CAT_RX, 100);
+  CHECK(timerRunning(TIMER_CAT_RX));
+  hostAdvance(60 * HOST_MSEC);
+  CHECK(ticks() < 100);   //it has wrapped
+  CHECK(!timerExpired(TIMER_CAT_RX));
+  hostAdvance(40 * HOST_MSEC);
+  CHECK(!timerExpired(TIMER_CAT_RX));
+  hostAdvance(2 * HOST_MSEC);
+  CHECK(timerExpired(TIMER_CAT_RX));
+
+  timerStop(TIMER_CAT_RX);
+  CHECK(!timerRunning(TIMER_CAT_RX));
+  CHECK(!timerExpired(TIMER_CAT_RX));
+
+  //and so does the radio, through the wrap
+  tick_preset(0xffffffff - 1000);
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(3 * HOST_SEC);
+  uint8_t getFreq[5] = {0, 0, 0, 0, 0x03};
+  hostSerialSend(getFreq, 5);
+  hostRun(hostNanos() + 100 * HOST_MSEC);
+  CHECK_EQ(hostSerialReceived().size(), 5);
+  return 0;
+}
@@ -0,0 +1,34 @@
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+
+/**
+ * A touch on the USB and LSB buttons switches the sideband when the finger lifts
+ */
+static void tap(int x, int y) {
+  hostTouch(x + BTN_W / 2, y + BTN_H / 2);
+  hostRun(hostNanos() + 150 * HOST_MSEC);
+  hostTouchRelease();
+  hostRun(hostNanos() + 150 * HOST_MSEC);
+}
+
+int main() {
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+  CHECK(!isUSB);
+  double bfo = hostSynth(1);
+  uint16_t unlit = hostPixel(COL1_X + 2, ROW3_Y + 2);
+
+  tap(COL1_X, ROW3_Y);
+  CHECK(isUSB);
+  CHECK(fabs(hostSynth(1) - (firstIF - usbCarrier)) < 10);
+  CHECK(hostSynth(1) != bfo);
+  //and it is lit up now
+  CHECK(hostPixel(COL1_X + 2, ROW3_Y + 2) != unlit);
+
+  tap(COL2_X, ROW3_Y);
+  CHECK(!isUSB);
+  CHECK_EQ(hostPixel(COL1_X + 2, ROW3_Y + 2), unlit);
+  return 0;
+}
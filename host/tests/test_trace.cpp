@@ -0,0 +1,66 @@
+#include <string>
+#include "check.h"
+#include "host.h"
+#include "ubitx.h"
+#include "trace.h"
+
+/**
+ * The D2 dump read back as tools/trace_timeline.py reads it: the time now and the count,
+ * then 6 bytes an entry, <HBBH low byte first. A retune over CAT has to be in it, in order.
+ *
+ *   test_trace [file]    also saves the dump, for the script to decode
+ */
+static unsigned le16(const std::string &s, size_t at) {
+  return (uint8_t)s[at] | (uint8_t)s[at + 1] << 8;
+}
+
+int main(int argc, char **argv) {
+  hostEepromDefaults();
+  hostBoot();
+  hostRun(2 * HOST_SEC);
+
+  //to 14.200 MHz
+  static const uint8_t tune[5] = {0x01, 0x42, 0x00, 0x00, 0x01};
+  hostSerialSend(tune, 5);
+  hostRun(hostNanos() + 100 * HOST_MSEC);
+  hostSerialReceived();
+
+  static const uint8_t dump[5] = {0, 0, 0, 0, 0xD2};
+  hostSerialSend(dump, 5);
+  hostRun(hostNanos() + 300 * HOST_MSEC);
+  std::string answer = hostSerialReceived();
+
+  CHECK(answer.size() >= 3);
+  unsigned now = le16(answer, 0), count = (uint8_t)answer[2];
+  CHECK(count > 2);
+  CHECK(count <= TRACE_ENTRIES);
+  CHECK_EQ(answer.size(), 3 + 6 * count);
+
+  //oldest first, each no newer than now
+  int cat = -1, freq = -1;
+  unsigned lastAge = 0xffff;
+  for (unsigned i = 0; i < count; i++) {
+    size_t at = 3 + 6 * i;
+    unsigned time = le16(answer, at), value = le16(answer, at + 4);
+    uint8_t event = answer[at + 2], data = answer[at + 3];
+    unsigned age = (now - time) & 0xffff;
+    CHECK(age <= lastAge);
+    CHECK(age < 10000);
+    lastAge = age;
+    CHECK(event >= TRACE_TX_START && event <= TRACE_TX_BOUNDS);
+    if (event == TRACE_CAT && data == 0x01 && value == 0x0142)
+      cat = i;
+    if (event == TRACE_FREQ && value == 14200 && cat >= 0)
+      freq = i;
+  }
+  CHECK(cat >= 0);
+  CHECK(freq > cat);
+
+  if (argc > 1) {
+    FILE *f = fopen(argv[1], "wb");
+    CHECK(f);
+    CHECK_EQ(fwrite(answer.data(), 1, answer.size(), f), answer.size());
+    fclose(f);
+  }
+  return 0;
+}
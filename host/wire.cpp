@@ -0,0 +1,102 @@
+#include "host.h"
+#include <Wire.h>
+
+/**
+ * The I2C port with the Si5351 on it. A transmission is the address, then the register it
+ * starts at and the values for it and the ones after it. At 100 kHz a byte takes 9 bits of
+ * the clock, plus the start and the stop.
+ *
+ * The frequencies come from the registers as the chip would have them: the PLLs from the
+ * 25 MHz crystal and the multisynth parameters of regs 26 and 34, each clock from its own
+ * multisynth, its R divider and whether reg 3 and its control register have it on.
+ */
+#define SI5351_ADDR 0x60
+#define SI5351_XTAL 25000000.0
+
+TwoWire Wire;
+
+static uint32_t busClock = 100000;
+static uint8_t address;
+static std::vector<uint8_t> sent;
+static uint8_t failStatus = 0;
+static uint8_t regs[256];
+static double clocks[3];
+static std::function<void(int clk)> synthChanged;
+
+//the three parameters of a multisynth, the 8 registers from reg
+static double ratio(int reg) {
+  uint32_t p1 = ((uint32_t)(regs[reg + 2] & 0x03) << 16) | (regs[reg + 3] << 8) | regs[reg + 4];
+  uint32_t p2 = ((uint32_t)(regs[reg + 5] & 0x0f) << 16) | (regs[reg + 6] << 8) | regs[reg + 7];
+  uint32_t p3 = ((uint32_t)(regs[reg + 5] & 0xf0) << 12) | (regs[reg + 0] << 8) | regs[reg + 1];
+  if (!p3)
+    return 0;
+  return (p1 + 512 + (double)p2 / p3) / 128;
+}
+
+static double frequency(int clk) {
+  if ((regs[3] & (1 << clk)) || (regs[16 + clk] & 0x80))
+    return 0;
+  double vco = SI5351_XTAL * ratio(regs[16 + clk] & 0x20 ? 34 : 26);
+  double divider = ratio(42 + 8 * clk);
+  if (!divider)
+    return 0;
+  return vco / divider / (1 << ((regs[42 + 8 * clk + 2] >> 4) & 7));
+}
+
+void TwoWire::begin() {
+}
+
+void TwoWire::setClock(uint32_t clock) {
+  busClock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t to) {
+  address = to;
+  sent.clear();
+}
+
+size_t TwoWire::write(uint8_t data) {
+  sent.push_back(data);
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t n) {
+  sent.insert(sent.end(), data, data + n);
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+  hostAdvance(20 * HOST_USEC + (sent.size() + 1) * 9 * HOST_SEC / busClock);
+  if (failStatus)
+    return failStatus;
+  if (address != SI5351_ADDR)
+    return 2;   //nobody answered the address
+  if (sent.empty())
+    return 0;
+
+  uint8_t reg = sent[0];
+  for (size_t i = 1; i < sent.size(); i++)
+    regs[(uint8_t)(reg + i - 1)] = sent[i];
+
+  for (int clk = 0; clk < 3; clk++) {
+    double f = frequency(clk);
+    if (f != clocks[clk]) {
+      clocks[clk] = f;
+      if (synthChanged)
+        synthChanged(clk);
+    }
+  }
+  return 0;
+}
+
+double hostSynth(int clk) {
+  return clk >= 0 && clk < 3 ? clocks[clk] : 0;
+}
+
+void hostOnSynth(std::function<void(int clk)> changed) {
+  synthChanged = changed;
+}
+
+void hostI2cFail(uint8_t status) {
+  failStatus = status;
+}
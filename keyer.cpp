@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "ubitx.h"
+#include "fastio.h"
+#include "trace.h"
 /* N8LOV Mods
     20210107 - Inhibit Tx when Tx Frequency is out of bounds for hardware.
 */
@@ -86,31 +88,32 @@ char lastPaddle = 0;
 /**
    Starts transmitting the carrier with the sidetone
    It assumes that we have called cwTxStart and not called cwTxStop
-   each time it is called, the cwTimeOut is pushed further into the future
+   each time it is called, the cw hang timer is pushed further into the future
 */
 void cwKeydown() {
 
   keyDown = true;                  //tracks the CW_KEY
   tone(CW_TONE, (int)sideTone);
-  if (!inhibitTx) digitalWrite(CW_KEY, 1);  // N8LOV - allow keying only when not Tx inhibited
+  //N8LOV - allow keying only when not Tx inhibited, and not once CAT has ended the transmit in the start delay
+  if (inTx && !inhibitTx) FastPin<CW_KEY>::high();
 
   //Modified by KD8CEC, for CW Delay Time save to eeprom
   //cwTimeout = millis() + CW_TIMEOUT;
-  cwTimeout = millis() + cwDelayTime * 10;
+  timerStart(TIMER_CW, cwDelayTime * 10);
 }
 
 /**
    Stops the cw carrier transmission along with the sidetone
-   Pushes the cwTimeout further into the future
+   Pushes the cw hang timer further into the future
 */
 void cwKeyUp() {
   keyDown = false;    //tracks the CW_KEY
   noTone(CW_TONE);
-  digitalWrite(CW_KEY, 0);
+  FastPin<CW_KEY>::low();
 
   //Modified by KD8CEC, for CW Delay Time save to eeprom
   //cwTimeout = millis() + CW_TIMEOUT;
-  cwTimeout = millis() + cwDelayTime * 10;
+  timerStart(TIMER_CW, cwDelayTime * 10);
 }
 
 //Variables for Ron's new logic
@@ -120,8 +123,11 @@ void cwKeyUp() {
 #define PDLSWAP 0x08 // 0 for normal, 1 for swap
 #define IAMBICB 0x10 // 0 for Iambic A, 1 for Iambic B
 enum KSTYPE {IDLE, CHK_DIT, CHK_DAH, KEYED_PREP, KEYED, INTER_ELEMENT };
-static unsigned long ktimer;
+static unsigned ktimer;   //length of the element being sent, the keyer timer runs it out
 unsigned char keyerState = IDLE;
+#if TRACE
+static unsigned char tracedState = IDLE;
+#endif
 
 //Below is a test to reduce the keying error. do not delete lines
 //create by KD8CEC for compatible with new CW Logic
@@ -134,7 +140,7 @@ char update_PaddleLatch(byte isUpdateKeyState) {
   //printLine2(b);
 
   //use the PTT as the key for tune up, quick QSOs
-  if (digitalRead(PTT) == 0)
+  if (FastPin<PTT>::read() == 0)
     tmpKeyerControl |= DIT_L;
   else if (paddle >= cwAdcDashFrom && paddle <= cwAdcDashTo)
     tmpKeyerControl |= DAH_L;
@@ -144,7 +150,7 @@ char update_PaddleLatch(byte isUpdateKeyState) {
     tmpKeyerControl |= (DAH_L | DIT_L) ;
   else
   {
-    if (Iambic_Key)
+    if (FEATURE_IAMBIC && Iambic_Key)
       tmpKeyerControl = 0 ;
     else if (paddle >= cwAdcSTFrom && paddle <= cwAdcSTTo)
       tmpKeyerControl = DIT_L ;
@@ -167,7 +173,8 @@ void cwKeyer(void) {
   bool continue_loop = true;
   unsigned tmpKeyControl = 0;
 
-  if ( Iambic_Key ) {
+  //a build without the iambic keyer takes the paddle as a straight key whatever the setting
+  if (FEATURE_IAMBIC && Iambic_Key) {
     while (continue_loop) {
       switch (keyerState) {
         case IDLE:
@@ -177,8 +184,8 @@ void cwKeyer(void) {
             update_PaddleLatch(1);
             keyerState = CHK_DIT;
           } else {
-            if (0 < cwTimeout && cwTimeout < millis()) {
-              cwTimeout = 0;
+            if (timerExpired(TIMER_CW)) {
+              timerStop(TIMER_CW);
               stopTx();
             }
             continue_loop = false;
@@ -211,20 +218,22 @@ void cwKeyer(void) {
             active_delay(delayBeforeCWStartTime * 2);
 
             keyDown = false;
-            cwTimeout = millis() + cwDelayTime * 10;  //+ CW_TIMEOUT;
+            timerStart(TIMER_CW, cwDelayTime * 10);  //+ CW_TIMEOUT;
             startTx(TX_CW);
           }
-          ktimer += millis(); // set ktimer to interval end time
+          timerStart(TIMER_KEYER, ktimer); // run until the interval end time
           keyerControl &= ~(DIT_L + DAH_L); // clear both paddle latch bits
           keyerState = KEYED; // next state
 
           cwKeydown();
+          cwTimingDown();
           break;
 
         case KEYED:
-          if (millis() > ktimer) { // are we at end of key down ?
+          if (timerExpired(TIMER_KEYER)) { // are we at end of key down ?
             cwKeyUp();
-            ktimer = millis() + cwSpeed; // inter-element time
+            cwTimingUp(ktimer);
+            timerStart(TIMER_KEYER, cwSpeed); // inter-element time
             keyerState = INTER_ELEMENT; // next state
           } else if (keyerControl & IAMBICB) {
             update_PaddleLatch(1); // early paddle latch in Iambic B mode
@@ -234,7 +243,7 @@ void cwKeyer(void) {
         case INTER_ELEMENT:
           // Insert time between dits/dahs
           update_PaddleLatch(1); // latch paddle state
-          if (millis() > ktimer) { // are we at end of inter-space ?
+          if (timerExpired(TIMER_KEYER)) { // are we at end of inter-space ?
             if (keyerControl & DIT_PROC) { // was it a dit or dah ?
               keyerControl &= ~(DIT_L + DIT_PROC); // clear two bits
               keyerState = CHK_DAH; // dit done, check for dah
@@ -245,6 +254,12 @@ void cwKeyer(void) {
           }
           break;
       }
+#if TRACE
+      if (keyerState != tracedState) {
+        tracedState = keyerState;
+        trace(TRACE_KEYER, keyerState, 0);
+      }
+#endif
 
       checkCAT();
     } //end of while
@@ -262,7 +277,11 @@ void cwKeyer(void) {
           active_delay(delayBeforeCWStartTime * 2);
 
           keyDown = false;
-          cwTimeout = millis() + cwDelayTime * 10;  //+ CW_TIMEOUT;
+          timerStart(TIMER_CW, cwDelayTime * 10);  //+ CW_TIMEOUT;
+
+          //let go during the delay, keying now would only put a click on the air
+          if (update_PaddleLatch(0) != DIT_L)
+            continue;
         }
         cwKeydown();
 
@@ -272,8 +291,8 @@ void cwKeyer(void) {
         cwKeyUp();
       }
       else {
-        if (0 < cwTimeout && cwTimeout < millis()) {
-          cwTimeout = 0;
+        if (timerExpired(TIMER_CW)) {
+          timerStop(TIMER_CW);
           keyDown = false;
           stopTx();
         }
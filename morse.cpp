@@ -72,7 +72,7 @@ static void morseLetter(char c) {
     return;
   }
 
-  for (int i = 0; i < sizeof(morse_table) / sizeof(struct Morse); i++) {
+  for (unsigned i = 0; i < sizeof(morse_table) / sizeof(struct Morse); i++) {
     struct Morse m;
     memcpy_P(&m, morse_table + i, sizeof(struct Morse));
 
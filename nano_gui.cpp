@@ -2,17 +2,21 @@
 #include <EEPROM.h>
 #include "ubitx.h"
 #include "nano_gui.h"
+#include "fastio.h"
+#include "trace.h"
 
 //#include "Adafruit_GFX.h"
 //#include <XPT2046_Touchscreen.h>
 #include <SPI.h>
+#ifdef __AVR__
 #include <avr/pgmspace.h>
+#endif
 
 #define TFT_CS    10        
 #define TFT_RS    9
 
 
-GFXfont *gfxFont = NULL;
+const GFXfont *gfxFont = NULL;
 //int touch_x, touch_y;
 //XPT2046_Touchscreen ts(CS_PIN);
 //TS_Point ts_point;
@@ -38,10 +42,10 @@ void readTouchCalibration(){
 }
 
 void writeTouchCalibration(){
-  EEPROM.put(SLOPE_X, slope_x);
-  EEPROM.put(SLOPE_Y, slope_y);
-  EEPROM.put(OFFSET_X, offset_x);
-  EEPROM.put(OFFSET_Y, offset_y);    
+  eepromPut(SLOPE_X, slope_x);
+  eepromPut(SLOPE_Y, slope_y);
+  eepromPut(OFFSET_X, offset_x);
+  eepromPut(OFFSET_Y, offset_y);    
 }
 
 #define Z_THRESHOLD     400
@@ -53,7 +57,7 @@ static uint32_t msraw=0x80000000;
 static  int16_t xraw=0, yraw=0, zraw=0;
 static uint8_t rotation = 1;
 
-static int16_t touch_besttwoavg( int16_t x , int16_t y , int16_t z ) {
+int16_t touch_besttwoavg( int16_t x , int16_t y , int16_t z ) {
   int16_t da, db, dc;
   int16_t reta = 0;
   if ( x > y ) da = x - y; else da = y - x;
@@ -73,8 +77,10 @@ static void touch_update(){
   uint32_t now = millis();
   if (now - msraw < MSEC_THRESHOLD) return;
   
+  busEnter(BUS_TOUCH);
   SPI.beginTransaction(SPI_SETTING);
-  digitalWrite(CS_PIN, LOW);
+  FastPin<CS_PIN>::low();
+  busSelect();
   SPI.transfer(0xB1 /* Z1 */);
   int16_t z1 = SPI.transfer16(0xC1 /* Z2 */) >> 3;
   int z = z1 + 4095;
@@ -90,8 +96,10 @@ static void touch_update(){
   else data[0] = data[1] = data[2] = data[3] = 0; // Compiler warns these values may be used unset on early exit.
   data[4] = SPI.transfer16(0xD0 /* Y */) >> 3;  // Last Y touch power down
   data[5] = SPI.transfer16(0) >> 3;
-  digitalWrite(CS_PIN, HIGH);
+  FastPin<CS_PIN>::high();
   SPI.endTransaction();
+  busBytes(z >= Z_THRESHOLD ? 19 : 9);
+  busLeave();
   //Serial.printf("z=%d  ::  z1=%d,  z2=%d  ", z, z1, z2);
   if (z < 0) z = 0;
   if (z < Z_THRESHOLD) { // if ( !touched ) {
@@ -141,8 +149,8 @@ boolean readTouch(){
 }
 
 void scaleTouch(struct Point *p){
-  p->x = ((long)(p->x - offset_x) * 10l)/ (long)slope_x;
-  p->y = ((long)(p->y - offset_y) * 10l)/ (long)slope_y;
+  p->x = ((int32_t)(p->x - offset_x) * 10l)/ (int32_t)slope_x;
+  p->y = ((int32_t)(p->y - offset_y) * 10l)/ (int32_t)slope_y;
 
 // Serial.print(p->x); Serial.print(",");Serial.println(p->y);
  
@@ -181,20 +189,22 @@ inline uint8_t * pgm_read_bitmap_ptr(const GFXfont *gfxFont){
 
 inline static void utft_write(unsigned char d){
   SPI.transfer(d);
+  busBytes(1);
 }
 
 inline static void utftCmd(unsigned char VH){   
-  *(portOutputRegister(digitalPinToPort(TFT_RS))) &=  ~digitalPinToBitMask(TFT_RS);//LCD_RS=0;
+  FastPin<TFT_RS>::low();  //LCD_RS=0;
   utft_write(VH);
 }
 
 inline static void utftData(unsigned char VH){
-  *(portOutputRegister(digitalPinToPort(TFT_RS)))|=  digitalPinToBitMask(TFT_RS);//LCD_RS=1;
+  FastPin<TFT_RS>::high(); //LCD_RS=1;
   utft_write(VH);
 }
 
 
 static void utftAddress(unsigned int x1,unsigned int y1,unsigned int x2,unsigned int y2){
+  busEnter(BUS_ADDRESS);
 
   utftCmd(0x2a);
   utftData(x1>>8);
@@ -207,31 +217,38 @@ static void utftAddress(unsigned int x1,unsigned int y1,unsigned int x2,unsigned
   utftData(y2>>8);
   utftData(y2);
   utftCmd(0x2c);               
+  busLeave();
 }
 
 void displayPixel(unsigned int x, unsigned int y, unsigned int c){  
-  unsigned int i,j;
-  digitalWrite(TFT_CS,LOW);
+  busEnter(BUS_PIXEL);
+  FastPin<TFT_CS>::low();
+  busSelect();
 
   utftCmd(0x02c); //write_memory_start
   utftAddress(x,y,x,y);
   utftData(c>>8);
   utftData(c);
+  busPixels(1);
 
-  digitalWrite(TFT_CS,HIGH);   
+  FastPin<TFT_CS>::high();   
+  busLeave();
 }
 
 #define MAX_VBUFF 64
 char vbuff[64];
 void quickFill(int x1, int y1, int x2, int y2, int color){
-  unsigned long ncount = (unsigned long)(x2 - x1+1) * (unsigned long)(y2-y1+1);
+  uint32_t ncount = (uint32_t)(x2 - x1+1) * (uint32_t)(y2-y1+1);
   int k = 0;
+  busEnter(BUS_QUICKFILL);
+  busPixels(ncount);
 
   //set the window
-  digitalWrite(TFT_CS,LOW);
+  FastPin<TFT_CS>::low();
+  busSelect();
   utftCmd(0x02c); //write_memory_start  
   utftAddress(x1,y1,x2,y2);
-  *(portOutputRegister(digitalPinToPort(TFT_RS)))|=  digitalPinToBitMask(TFT_RS);//LCD_RS=1;  
+  FastPin<TFT_RS>::high(); //LCD_RS=1;  
   
   while(ncount){
     k = 0;
@@ -242,15 +259,18 @@ void quickFill(int x1, int y1, int x2, int y2, int color){
 
     if (ncount > MAX_VBUFF/2){
       SPI.transfer(vbuff, MAX_VBUFF);
+      busBytes(MAX_VBUFF);
       ncount -= MAX_VBUFF/2;
     }  
     else{
       SPI.transfer(vbuff, (int)ncount * 2);
+      busBytes(ncount * 2);
       ncount = 0;      
     }
     checkCAT();
   }
-  digitalWrite(TFT_CS, HIGH);
+  FastPin<TFT_CS>::high();
+  busLeave();
 }
 
 void displayHline(unsigned int x, unsigned int y, unsigned int l, unsigned int c){  
@@ -273,15 +293,19 @@ void displayRect(unsigned int x,unsigned int y,unsigned int w,unsigned int h,uns
 }
 
 void displayFillrect(unsigned int x,unsigned int y,unsigned int w,unsigned int h,unsigned int c){
-  unsigned int i;
   quickFill(x,y,x+w,y+h, c);
 }
 
-bool xpt2046_Init(){
+static void xpt2046_Init(){
   pinMode(CS_PIN, OUTPUT);
-  digitalWrite(CS_PIN, HIGH);
+  FastPin<CS_PIN>::high();
 }
 
+//when the controller was told to leave its sleep mode, it takes 120 msec before it can be switched on
+static uint32_t sleepOutAt;
+
+//displayInit() sends the setup and the sleep-out, displayStart() switches the display on when the
+//controller is ready. The radio is set up in between instead of waiting for the controller.
 void displayInit(void){
 
   SPI.begin();
@@ -294,7 +318,7 @@ void displayInit(void){
   pinMode(TFT_RS,OUTPUT);
 
 
-  digitalWrite(TFT_CS,LOW);  //CS
+  FastPin<TFT_CS>::low();  //CS
   utftCmd(0xCB);  
   utftData(0x39); 
   utftData(0x2C); 
@@ -354,11 +378,8 @@ void displayInit(void){
   utftData(0x27);  
 
   utftCmd(0x11);    //Exit Sleep 
-  delay(120); 
-      
-  utftCmd(0x29);    //Display on 
-  utftCmd(0x2c); 
-  digitalWrite(TFT_CS,HIGH);
+  sleepOutAt = millis();
+  FastPin<TFT_CS>::high();
 
   //now to init the touch screen controller
   //ts.begin();
@@ -368,6 +389,32 @@ void displayInit(void){
   readTouchCalibration();  
 }
 
+void displayStart(void){
+  while (millis() - sleepOutAt < 120)
+    ;
+
+  FastPin<TFT_CS>::low();
+  utftCmd(0x29);    //Display on 
+  utftCmd(0x2c); 
+  FastPin<TFT_CS>::high();
+}
+
+//the display keeps its memory while asleep, nothing needs to be redrawn on waking up
+void displaySleep(){
+  FastPin<TFT_CS>::low();
+  utftCmd(0x28);    //Display off
+  utftCmd(0x10);    //Enter Sleep
+  FastPin<TFT_CS>::high();
+}
+
+void displayWake(){
+  FastPin<TFT_CS>::low();
+  utftCmd(0x11);    //Exit Sleep
+  delay(5);         //the controller needs 5 msec before it takes the next command
+  utftCmd(0x29);    //Display on
+  FastPin<TFT_CS>::high();
+}
+
 // Draw a character
 /**************************************************************************/
 /*!
@@ -386,47 +433,72 @@ void displayInit(void){
 void displayChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg) {
   c -= (uint8_t)pgm_read_byte(&gfxFont->first);
   GFXglyph *glyph  = pgm_read_glyph_ptr(gfxFont, c);
-  uint8_t  *bitmap = pgm_read_bitmap_ptr(gfxFont);
-  
-  uint16_t bo = pgm_read_word(&glyph->bitmapOffset);
+  uint8_t  *bitmap = pgm_read_bitmap_ptr(gfxFont) + pgm_read_word(&glyph->bitmapOffset);
+
   uint8_t  w  = pgm_read_byte(&glyph->width),
            h  = pgm_read_byte(&glyph->height);
   int8_t   xo = pgm_read_byte(&glyph->xOffset),
            yo = pgm_read_byte(&glyph->yOffset);
-  uint8_t  xx, yy, bits = 0, bit = 0;
-  int16_t  xo16 = 0, yo16 = 0;
-  int k;
-  char vbuff[64]; // take a character that is upto 32 pixels wide (2 bytes per pixel)      
-  digitalWrite(TFT_CS,LOW);
-  
-  for(yy=0; yy<h; yy++) {
-    k = 0;
-    for(xx=0; xx<w; xx++) {
-      if(!(bit++ & 7)) {
-        bits = pgm_read_byte(&bitmap[bo++]);
-      }
-      if(bits & 0x80) {
-        vbuff[k++] = color >> 8;
-        vbuff[k++] = color & 0xff;
-      }
-      else {
-        vbuff[k++] = bg >> 8;
-        vbuff[k++] = bg & 0xff;
-      }
-      bits <<= 1;
+  unsigned int pixels = w * h;
+  //the two colours split into the bytes that are sent, once for the glyph instead of for each pixel
+  uint8_t  colorHi = color >> 8, colorLo = color,
+           bgHi = bg >> 8, bgLo = bg;
+  uint8_t  bits = 0;
+  int k = 0;
+
+  //a space has nothing to draw
+  if (!pixels)
+    return;
+
+  busEnter(BUS_CHAR);
+  FastPin<TFT_CS>::low();
+  busSelect();
+
+  //one window for the whole glyph, the display moves to the next row by itself, and the
+  //bits of the rows follow on from each other in the bitmap just the same
+  utftAddress(x+xo, y+yo, x+xo+w-1, y+yo+h-1);
+  FastPin<TFT_RS>::high(); //LCD_RS=1;
+
+  //the pixels go out through the vbuff of quickFill(), not a buffer on the stack
+  for (unsigned int i = 0; i < pixels; i++) {
+    if (!(i & 7))
+      bits = pgm_read_byte(bitmap++);
+    if (bits & 0x80) {
+      vbuff[k++] = colorHi;
+      vbuff[k++] = colorLo;
+    }
+    else {
+      vbuff[k++] = bgHi;
+      vbuff[k++] = bgLo;
+    }
+    bits <<= 1;
+    if (k == MAX_VBUFF) {
+      SPI.transfer(vbuff, k);
+      busBytes(k);
+      k = 0;
     }
-    utftAddress(x+xo,y+yo+yy,x+xo+w,y+yo+yy);
-    *(portOutputRegister(digitalPinToPort(TFT_RS)))|=  digitalPinToBitMask(TFT_RS);//LCD_RS=1;  
-    SPI.transfer(vbuff, k);    
-    checkCAT();
   }
+  if (k) {
+    SPI.transfer(vbuff, k);
+    busBytes(k);
+  }
+  busPixels(pixels);
+
+  FastPin<TFT_CS>::high();
+  busLeave();
+  checkCAT();
 }
 
-int displayTextExtent(char *text) {
+//the text may be in the RAM or in the flash (F("...") and PSTR("...")), this reads either
+static inline char textChar(const char *text, bool inFlash){
+  return inFlash ? pgm_read_byte(text) : *text;
+}
+
+static int textExtent(const char *text, bool inFlash) {
 
   int ext = 0;
-  while(*text){
-    char c = *text++;
+  char c;
+  while((c = textChar(text++, inFlash))){
     uint8_t first = pgm_read_byte(&gfxFont->first);
     if((c >= first) && (c <= (uint8_t)pgm_read_byte(&gfxFont->last))) {
         GFXglyph *glyph  = pgm_read_glyph_ptr(gfxFont, c - first);
@@ -436,10 +508,9 @@ int displayTextExtent(char *text) {
   return ext;
 }
 
-void displayRawText(char *text, int x1, int y1, int color, int background){
-  while(*text){
-    char c = *text++;
-    
+static void rawText(const char *text, bool inFlash, int x1, int y1, int color, int background){
+  char c;
+  while((c = textChar(text++, inFlash))){
     uint8_t first = pgm_read_byte(&gfxFont->first);
     if((c >= first) && (c <= (uint8_t)pgm_read_byte(&gfxFont->last))) {
   
@@ -447,7 +518,6 @@ void displayRawText(char *text, int x1, int y1, int color, int background){
         uint8_t   w     = pgm_read_byte(&glyph->width),
                   h     = pgm_read_byte(&glyph->height);
         if((w > 0) && (h > 0)) { // Is there an associated bitmap?
-            int16_t xo = (int8_t)pgm_read_byte(&glyph->xOffset); // sic
             displayChar(x1, y1+TEXT_LINE_HEIGHT, c, color, background);
             checkCAT();
         }
@@ -457,99 +527,83 @@ void displayRawText(char *text, int x1, int y1, int color, int background){
 }
 
 // The generic routine to display one line on the LCD 
-void displayText(char *text, int x1, int y1, int w, int h, int color, int background, int border) {
+static void boxText(const char *text, bool inFlash, int x1, int y1, int w, int h, int color, int background, int border) {
 
   displayFillrect(x1, y1, w ,h, background);
   displayRect(x1, y1, w ,h, border);
 
-  x1 += (w - displayTextExtent(text))/2;
+  x1 += (w - textExtent(text, inFlash))/2;
   y1  += (h - TEXT_LINE_HEIGHT)/2;
-  while(*text){
-    char c = *text++;
-    
-    uint8_t first = pgm_read_byte(&gfxFont->first);
-    if((c >= first) && (c <= (uint8_t)pgm_read_byte(&gfxFont->last))) {
-  
-        GFXglyph *glyph  = pgm_read_glyph_ptr(gfxFont, c - first);
-        uint8_t   w     = pgm_read_byte(&glyph->width),
-                  h     = pgm_read_byte(&glyph->height);
-        if((w > 0) && (h > 0)) { // Is there an associated bitmap?
-            int16_t xo = (int8_t)pgm_read_byte(&glyph->xOffset); // sic
-            displayChar(x1, y1+TEXT_LINE_HEIGHT, c, color, background);
-            checkCAT();
-        }
-        x1 += (uint8_t)pgm_read_byte(&glyph->xAdvance);    
-    }
-  }//end of the while loop of the characters to be printed
+  rawText(text, inFlash, x1, y1, color, background);
+}
+
+int displayTextExtent(char *text) {
+  return textExtent(text, false);
+}
+
+int displayTextExtent(const __FlashStringHelper *text) {
+  return textExtent((const char *)text, true);
+}
+
+void displayRawText(char *text, int x1, int y1, int color, int background){
+  rawText(text, false, x1, y1, color, background);
+}
+
+void displayRawText(const __FlashStringHelper *text, int x1, int y1, int color, int background){
+  rawText((const char *)text, true, x1, y1, color, background);
 }
 
-void setupTouch(){
+void displayText(char *text, int x1, int y1, int w, int h, int color, int background, int border) {
+  boxText(text, false, x1, y1, w, h, color, background, border);
+}
+
+void displayText(const __FlashStringHelper *text, int x1, int y1, int w, int h, int color, int background, int border) {
+  boxText((const char *)text, true, x1, y1, w, h, color, background, border);
+}
+
+/**
+   The touch calibration, a dialog like the others (see ubitx.h): a cross in each corner in
+   turn, its point taken when the finger comes off it
+*/
+static const int touchCross[4][2] = {{20, 20}, {300, 20}, {20, 220}, {300, 220}};
+static int touchAt[4][2];
+static byte touchCorner;
+static bool touchDown;
+static void (*touchDone)();
+
+static void drawCross(byte corner, int color) {
+  displayHline(touchCross[corner][0] - 10, touchCross[corner][1], 20, color);
+  displayVline(touchCross[corner][0], touchCross[corner][1] - 10, 20, color);
+}
+
+static void setupTouchStep(){
   int x1, y1, x2, y2, x3, y3, x4, y4;
-  
-  displayClear(DISPLAY_BLACK);
-  displayText("Click on the cross", 20,100, 200, 50, DISPLAY_WHITE, DISPLAY_BLACK, DISPLAY_BLACK);
 
-  // TOP-LEFT
-  displayHline(10,20,20,DISPLAY_WHITE);
-  displayVline(20,10,20, DISPLAY_WHITE);
+  if (!dialogSettled())
+    return;
 
-  while(!readTouch())
-    delay(100);
-  while(readTouch())
-    delay(100);
-   x1 = ts_point.x;
-   y1 = ts_point.y; 
+  if (readTouch()) {
+    touchDown = true;
+    touchAt[touchCorner][0] = ts_point.x;
+    touchAt[touchCorner][1] = ts_point.y;
+    return;
+  }
+  if (!touchDown)
+    return;
+  touchDown = false;
 
   //rubout the previous one
-  displayHline(10,20,20,DISPLAY_BLACK);
-  displayVline(20,10,20, DISPLAY_BLACK);
-
-  delay(1000);
-   
-  //TOP RIGHT
-  displayHline(290,20,20,DISPLAY_WHITE);
-  displayVline(300,10,20, DISPLAY_WHITE);
-
-  while(!readTouch())
-    delay(100); 
-  while(readTouch())
-    delay(100);
-   x2 = ts_point.x;
-   y2 = ts_point.y; 
-
-  displayHline(290,20,20,DISPLAY_BLACK);
-  displayVline(300,10,20, DISPLAY_BLACK);
-
-  delay(1000);
-
-  //BOTTOM LEFT
-  displayHline(10,220,20,DISPLAY_WHITE);
-  displayVline(20,210,20, DISPLAY_WHITE);
-  
-  while(!readTouch())
-    delay(100);
-   x3 = ts_point.x;
-   y3 = ts_point.y; 
-     
-  while(readTouch())
-    delay(100);
-  displayHline(10,220,20,DISPLAY_BLACK);
-  displayVline(20,210,20, DISPLAY_BLACK);
-
-  delay(1000);
-
-  //BOTTOM RIGHT
-  displayHline(290,220,20,DISPLAY_WHITE);
-  displayVline(300,210,20, DISPLAY_WHITE);
-
-  while(!readTouch())
-    delay(100);
-   x4 = ts_point.x;
-   y4 = ts_point.y; 
-     
-  
-  displayHline(290,220,20,DISPLAY_BLACK);
-  displayVline(300,210,20, DISPLAY_BLACK);
+  drawCross(touchCorner, DISPLAY_BLACK);
+  if (++touchCorner < 4) {
+    drawCross(touchCorner, DISPLAY_WHITE);
+    dialogSettle(1000);
+    return;
+  }
+
+  x1 = touchAt[0][0]; y1 = touchAt[0][1];
+  x2 = touchAt[1][0]; y2 = touchAt[1][1];
+  x3 = touchAt[2][0]; y3 = touchAt[2][1];
+  x4 = touchAt[3][0]; y4 = touchAt[3][1];
 
   // we average two readings and divide them by half and store them as scaled integers 10 times their actual, fractional value
   //the x points are located at 20 and 300 on x axis, hence, the delta x is 280, we take 28 instead, to preserve fractional value,
@@ -563,18 +617,22 @@ void setupTouch(){
   offset_x = x1 + -((20 * slope_x)/10);
   offset_y = y1 + -((20 * slope_y)/10);
 
-/*
-  Serial.print(x1);Serial.print(':');Serial.println(y1);
-  Serial.print(x2);Serial.print(':');Serial.println(y2);
-  Serial.print(x3);Serial.print(':');Serial.println(y3);
-  Serial.print(x4);Serial.print(':');Serial.println(y4);
-  
-  //for debugging
-  Serial.print(slope_x); Serial.print(' ');
-  Serial.print(slope_y); Serial.print(' ');
-  Serial.print(offset_x); Serial.print(' ');
-  Serial.println(offset_y); Serial.println(' ');
-*/  
   writeTouchCalibration();
   displayClear(DISPLAY_BLACK);
+  dialogClose();
+  touchDone();
+}
+
+void setupTouch(void (*done)()){
+  touchDone = done;
+  touchCorner = 0;
+  touchDown = false;
+
+  displayClear(DISPLAY_BLACK);
+  displayText(F("Click on the cross"), 20,100, 200, 50, DISPLAY_WHITE, DISPLAY_BLACK, DISPLAY_BLACK);
+  // TOP-LEFT
+  drawCross(0, DISPLAY_WHITE);
+
+  dialogOpen(setupTouchStep);
+  dialogSettle(50);
 }
@@ -7,7 +7,10 @@ struct Point {
 };
 extern struct Point ts_point;
 
-void displayInit();
+void displayInit();   //starts the controller, it needs 120 msec before displayStart() can switch it on
+void displayStart();
+void displaySleep();  //switches the display off and the controller to its sleep mode
+void displayWake();
 void displayClear(unsigned int color);
 void displayPixel(unsigned int x, unsigned int y, unsigned int c);
 void displayHline(unsigned int x, unsigned int y, unsigned int l, unsigned int c);
@@ -15,15 +18,20 @@ void displayVline(unsigned int x, unsigned int y, unsigned int l, unsigned int c
 void displayRect(unsigned int x,unsigned int y,unsigned int w,unsigned int h,unsigned int c);
 void displayFillrect(unsigned int x,unsigned int y,unsigned int w,unsigned int h,unsigned int c);
 void displayChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg);
+//the text functions take strings in the RAM or, through F("..."), in the flash
 int displayTextExtent(char *text);
+int displayTextExtent(const __FlashStringHelper *text);
 void displayRawText(char *text, int x1, int y1, int color, int background);
+void displayRawText(const __FlashStringHelper *text, int x1, int y1, int color, int background);
 void displayText(char *text, int x1, int y1, int w, int h, int color, int background, int border);
+void displayText(const __FlashStringHelper *text, int x1, int y1, int w, int h, int color, int background, int border);
 
 /* touch functions */
 boolean readTouch();
 
-void setupTouch();
+void setupTouch(void (*done)());   //opens the touch calibration dialog, done is called once it is saved
 void scaleTouch(struct Point *p);
+int16_t touch_besttwoavg(int16_t x, int16_t y, int16_t z);
 
 // Color definitions
 #define DISPLAY_BLACK       0x0000  ///<   0,   0,   0
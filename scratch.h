@@ -0,0 +1,74 @@
+#ifndef _SCRATCH_H_
+#define _SCRATCH_H_
+
+/**
+ * Scratch space for formatting text.
+ *
+ * We used to slice and dice our strings on two global kitchen counters, b[30] and c[30].
+ * That went wrong as soon as two pieces of code used them at the same time: displayVFO()
+ * builds the frequency in one, formatFreq() works in the other, and the checkCAT() calls
+ * in the middle of drawing could run CAT code that scribbled over both.
+ *
+ * Now a function takes a lease on as many bytes as it needs,
+ *
+ *   Scratch<12> text;
+ *   formatFreq(frequency, text);
+ *
+ * and gives them back when it returns. The leases are stacked in one small arena, so a
+ * function called from inside another gets the bytes above its caller's and can't
+ * clobber them. The arena is sized for the deepest nesting of leases we have, which is
+ * a status line with a number formatted into it.
+ *
+ * A lease that doesn't fit is a bug: there is no memory for it that isn't already lent
+ * out. The host build stops right there, so that the tests and the harnesses fail on it
+ * with the nesting on the stack. The radio counts it in scratchOverflows, read over CAT
+ * (0xD5), and gets the top of the arena, over the lease below.
+ */
+#define SCRATCH_SIZE 40
+
+extern char scratchArena[SCRATCH_SIZE];
+extern byte scratchTop;        //the first free byte of the arena
+extern byte scratchOverflows;  //leases that didn't fit, should always be zero
+#ifdef UBITX_HOST
+void scratchOverflow(byte size, byte used);   //host/sketch.cpp, stops the program
+#endif
+
+template<byte size>
+class Scratch {
+  static_assert(size <= SCRATCH_SIZE, "a scratch lease can't be bigger than the arena");
+
+public:
+  Scratch() {
+    byte start = scratchTop;
+
+    //never hand out memory past the arena, share the top of it instead and count the mistake
+    if (start + size > SCRATCH_SIZE) {
+      scratchOverflows++;
+#ifdef UBITX_HOST
+      scratchOverflow(size, start);
+#endif
+      start = SCRATCH_SIZE - size;
+    }
+    saved = scratchTop;
+    scratchTop = start + size;
+    buff = scratchArena + start;
+    buff[0] = 0;
+  }
+
+  ~Scratch() {
+    scratchTop = saved;
+  }
+
+  operator char *() {
+    return buff;
+  }
+
+  static const byte length = size;
+
+private:
+  Scratch(const Scratch &);   //a lease can't be copied
+  char *buff;
+  byte saved;
+};
+
+#endif
@@ -3,6 +3,8 @@
 #include "morse.h"
 #include "ubitx.h"
 #include "nano_gui.h"
+#include "scratch.h"
+#include "trace.h"
 /* N8LOV Mods
    20210105 - Provide for finer tuning of frequency calibration value
    20210111 - Use screen touch to save settings.
@@ -21,155 +23,221 @@
     - If the menu item is NOT clicked on, then the menu's prompt is to be displayed
 */
 
-void setupExit() {
-  menuOn = 0;
+//each setup dialog returns through here, to the setup menu or to the next step of calibration
+static void (*setupDone)();
+
+//the dialogs save on a touch, the finger has to come off the screen first
+static bool touchArmed;
+
+static bool setupTouched() {
+  if (!readTouch()) {
+    touchArmed = true;
+    return false;
+  }
+  return touchArmed;
+}
+
+static void setupOpen(DialogStep step, unsigned int settle) {
+  touchArmed = false;
+  dialogOpen(step);
+  dialogPace(settle);
 }
 
 //this is used by the si5351 routines in the ubitx_5351 file
 extern int32_t calibration;
 extern uint32_t si5351bx_vcoa;
 
-void setupFreq() {
+static void setupFreqStep() {
   int knob = 0;
-  int32_t prev_calibration;
 
-  displayDialog("Set Frequency", "Touch screen to Save");
+  if (!dialogSettled())
+    return;
+
+  if (/*btnDown()*/setupTouched()) { // N8LOV - using touch prevents unwanted changes due to knob rotation during button press
+    eepromPut(MASTER_CAL, calibration);
+    initOscillators();
+    si5351_set_calibration(calibration);
+    setFrequency(frequency);
+    setupDone();
+    return;
+  }
+
+  knob = enc_read();
+  if (knob != 0)
+    // N8LOV - provide for fine tuning.
+    // (875 only allows adjustment of clk2 to within 1/1000000 of precise frequency, resulting in calibration error of tens of hz)
+    calibration += knob * (knob > 2 ? 875 : 10);
+  /*   else if (knob < 0)
+       calibration -= 875; */
+  else
+    return; //don't update the frequency or the display
+
+  si5351bx_setfreq(0, usbCarrier);  //set back the cardrier oscillator anyway, cw tx switches it off
+  si5351_set_calibration(calibration);
+  setFrequency(frequency);
+
+  //displayRawText("Rotate to zerobeat", 20, 120, DISPLAY_CYAN, DISPLAY_NAVY);
+
+  Scratch<12> text;
+  ltoa(calibration, text, 10);
+  displayText(text, 100, 140, 100, 26, DISPLAY_CYAN, DISPLAY_NAVY, DISPLAY_WHITE);
+}
+
+void setupFreq() {
+  Scratch<16> text;
+
+  displayDialog(F("Set Frequency"), F("Touch screen to Save"));
 
   //round off the the nearest khz
   frequency = (frequency / 1000l) * 1000l;
   setFrequency(frequency);
 
-  displayRawText("You should have a", 20, 50, DISPLAY_CYAN, DISPLAY_NAVY);
-  displayRawText("signal exactly at ", 20, 75, DISPLAY_CYAN, DISPLAY_NAVY);
-  ltoa(frequency / 1000l, c, 10);
-  strcat(c, " KHz");
-  displayRawText(c, 20, 100, DISPLAY_CYAN, DISPLAY_NAVY);
+  displayRawText(F("You should have a"), 20, 50, DISPLAY_CYAN, DISPLAY_NAVY);
+  displayRawText(F("signal exactly at "), 20, 75, DISPLAY_CYAN, DISPLAY_NAVY);
+  ltoa(frequency / 1000l, text, 10);
+  strcat_P(text, PSTR(" KHz"));
+  displayRawText(text, 20, 100, DISPLAY_CYAN, DISPLAY_NAVY);
 
-  displayRawText("Rotate to zerobeat", 20, 180, DISPLAY_CYAN, DISPLAY_NAVY);
-  //keep clear of any previous button press
-  while (btnDown())
-    active_delay(100);
-  active_delay(100);
+  displayRawText(F("Rotate to zerobeat"), 20, 180, DISPLAY_CYAN, DISPLAY_NAVY);
 
-  prev_calibration = calibration;
   // calibration = 0; // N8LOV - display the last value to start
 
-  while (/*!btnDown()*/!readTouch()) // N8LOV - using touch prevents unwanted changes due to knob rotation during button press
-  {
-    knob = enc_read();
-    if (knob != 0)
-      // N8LOV - provide for fine tuning.
-      // (875 only allows adjustment of clk2 to within 1/1000000 of precise frequency, resulting in calibration error of tens of hz)
-      calibration += knob * (knob > 2 ? 875 : 10);
-    /*   else if (knob < 0)
-         calibration -= 875; */
-    else
-      continue; //don't update the frequency or the display
-
-    si5351bx_setfreq(0, usbCarrier);  //set back the cardrier oscillator anyway, cw tx switches it off
-    si5351_set_calibration(calibration);
-    setFrequency(frequency);
+  //keep clear of any previous button press
+  setupOpen(setupFreqStep, 100);
+}
+
+static uint32_t prevCarrier;
+
+static void setupBFOStep() {
+  int knob = 0;
 
-    //displayRawText("Rotate to zerobeat", 20, 120, DISPLAY_CYAN, DISPLAY_NAVY);
+  if (!dialogSettled())
+    return;
 
-    ltoa(calibration, b, 10);
-    displayText(b, 100, 140, 100, 26, DISPLAY_CYAN, DISPLAY_NAVY, DISPLAY_WHITE);
+  if (/*btnDown()*/setupTouched()) { // N8LOV - using touch prevents unwanted changes due to knob rotation during button press
+    if (prevCarrier != usbCarrier) eepromPut(USB_CAL, usbCarrier); // N8LOV - save it if it has changed
+    si5351bx_setfreq(0, usbCarrier);
+    setFrequency(frequency);
+    updateDisplay();
+    setupDone();
+    return;
   }
 
-  EEPROM.put(MASTER_CAL, calibration);
-  initOscillators();
-  si5351_set_calibration(calibration);
+  knob = enc_read();
+
+  if (knob != 0)
+    usbCarrier -= 50 * knob;
+  else
+    return; //don't update the frequency or the display
+
+  si5351bx_setfreq(0, usbCarrier);
   setFrequency(frequency);
+  printCarrierFreq(usbCarrier);
 
-  //debounce and delay
-  while (btnDown())
-    active_delay(50);
-  active_delay(100);
+  dialogPace(100);
 }
 
 void setupBFO() {
-  int knob = 0;
-  unsigned long prevCarrier;
-
   prevCarrier = usbCarrier;
 
-  displayDialog("Set BFO", "Touch screen to Save");
+  displayDialog(F("Set BFO"), F("Touch screen to Save"));
 
   if (usbCarrier > 11069000l || usbCarrier < 11049000l) usbCarrier = 11053000l; // N8LOV - use current unless out of rangeif 
   si5351bx_setfreq(0, usbCarrier);
   printCarrierFreq(usbCarrier);
 
-  while (/*!btnDown()*/!readTouch()) { // N8LOV - using touch prevents unwanted changes due to knob rotation during button press
-    knob = enc_read();
-
-    if (knob != 0)
-      usbCarrier -= 50 * knob;
-    else
-      continue; //don't update the frequency or the display
-
-    si5351bx_setfreq(0, usbCarrier);
-    setFrequency(frequency);
-    printCarrierFreq(usbCarrier);
+  setupOpen(setupBFOStep, 100);
+}
 
-    active_delay(100);
-  }
+static void displayCwDelay() {
+  Scratch<12> text;
 
-  if (prevCarrier != usbCarrier) EEPROM.put(USB_CAL, usbCarrier); // N8LOV - save it if it has changed
-  si5351bx_setfreq(0, usbCarrier);
-  setFrequency(frequency);
-  updateDisplay();
-  menuOn = 0;
+  itoa(10 * (int)cwDelayTime, text, 10);
+  strcat_P(text, PSTR(" msec"));
+  displayText(text, 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
 }
 
-void setupCwDelay() {
+static void setupCwDelayStep() {
   int knob = 0;
-  int prev_cw_delay;
 
-  displayDialog("Set CW T/R Delay", "Touch screen to Save");
+  if (!dialogSettled())
+    return;
+
+  if (/*btnDown()*/ setupTouched()) { // N8LOV - using touch prevents unwanted changes due to knob rotation during button press
+    eepromPut(CW_DELAYTIME, cwDelayTime);
+    //  cwDelayTime = getValueByKnob(10, 1000, 50,  cwDelayTime, "CW Delay>", " msec");
+    setupDone();
+    return;
+  }
 
-  active_delay(500);
-  prev_cw_delay = cwDelayTime;
+  knob = enc_read();
 
-  itoa(10 * (int)cwDelayTime, b, 10);
-  strcat(b, " msec");
-  displayText(b, 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
+  if (knob < 0 && cwDelayTime > 10)
+    cwDelayTime -= 10;
+  else if (knob > 0 && cwDelayTime < 100)
+    cwDelayTime += 10;
+  else
+    return; //don't update the frequency or the display
 
-  while (/*!btnDown()*/ !readTouch()) { // N8LOV - using touch prevents unwanted changes due to knob rotation during button press
-    knob = enc_read();
+  displayCwDelay();
+}
 
-    if (knob < 0 && cwDelayTime > 10)
-      cwDelayTime -= 10;
-    else if (knob > 0 && cwDelayTime < 100)
-      cwDelayTime += 10;
-    else
-      continue; //don't update the frequency or the display
+void setupCwDelay() {
+  displayDialog(F("Set CW T/R Delay"), F("Touch screen to Save"));
+  displayCwDelay();
+  setupOpen(setupCwDelayStep, 500);
+}
 
-    itoa(10 * (int)cwDelayTime, b, 10);
-    strcat(b, " msec");
-    displayText(b, 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
+static int tmp_key;
 
-  }
+static void displayKeyer() {
+  if (tmp_key == 0)
+    displayText(F("< Hand Key >"), 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
+  else if (tmp_key == 1)
+    displayText(F("< Iambic A >"), 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
+  else if (tmp_key == 2)
+    displayText(F("< Iambic B >"), 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
+}
 
-  EEPROM.put(CW_DELAYTIME, cwDelayTime);
+static void setupKeyerStep() {
+  int knob;
 
+  if (!dialogSettled())
+    return;
 
-  //  cwDelayTime = getValueByKnob(10, 1000, 50,  cwDelayTime, "CW Delay>", " msec");
+  if (dialogButton()) {
+    if (tmp_key == 0)
+      Iambic_Key = false;
+    else if (tmp_key == 1) {
+      Iambic_Key = true;
+      keyerControl &= ~IAMBICB;
+    }
+    else if (tmp_key == 2) {
+      Iambic_Key = true;
+      keyerControl |= IAMBICB;
+    }
 
-  active_delay(500);
-  menuOn = 0;
+    eepromPut(CW_KEY_TYPE, tmp_key);
+    setupDone();
+    return;
+  }
+
+  knob = enc_read();
+  if (knob == 0)
+    return;
+  if (knob < 0 && tmp_key > 0)
+    tmp_key--;
+  if (knob > 0)
+    tmp_key++;
+  if (tmp_key > 2)
+    tmp_key = 0;
+
+  displayKeyer();
+  dialogPace(50);
 }
 
 void setupKeyer() {
-  int tmp_key, knob;
-
-  displayDialog("Set CW Keyer", "Press tune to Save");
-
-  if (!Iambic_Key)
-    displayText("< Hand Key >", 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
-  else if (keyerControl & IAMBICB)
-    displayText("< Iambic A >", 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
-  else
-    displayText("< Iambic B >", 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
+  displayDialog(F("Set CW Keyer"), F("Press tune to Save"));
 
   if (!Iambic_Key)
     tmp_key = 0; //hand key
@@ -178,57 +246,23 @@ void setupKeyer() {
   else
     tmp_key = 1;
 
-  while (!btnDown())
-  {
-    knob = enc_read();
-    if (knob == 0) {
-      active_delay(50);
-      continue;
-    }
-    if (knob < 0 && tmp_key > 0)
-      tmp_key--;
-    if (knob > 0)
-      tmp_key++;
-    if (tmp_key > 2)
-      tmp_key = 0;
-
-    if (tmp_key == 0)
-      displayText("< Hand Key >", 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
-    else if (tmp_key == 1)
-      displayText("< Iambic A >", 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
-    else if (tmp_key == 2)
-      displayText("< Iambic B >", 100, 100, 120, 26, DISPLAY_CYAN, DISPLAY_BLACK, DISPLAY_BLACK);
-  }
-
-  active_delay(500);
-  if (tmp_key == 0)
-    Iambic_Key = false;
-  else if (tmp_key == 1) {
-    Iambic_Key = true;
-    keyerControl &= ~IAMBICB;
-  }
-  else if (tmp_key == 2) {
-    Iambic_Key = true;
-    keyerControl |= IAMBICB;
-  }
-
-  EEPROM.put(CW_KEY_TYPE, tmp_key);
-
-  menuOn = 0;
+  displayKeyer();
+  setupOpen(setupKeyerStep, 50);
 }
 
 void drawSetupMenu() {
   displayClear(DISPLAY_BLACK);
+  guiDirty(0, 0, FULL_W, FULL_H);
 
-  displayText("Setup", 10, 10, 300, 35, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_WHITE);
+  displayText(F("Setup"), 10, 10, 300, 35, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_WHITE);
   displayRect(10, 10, 300, 220, DISPLAY_WHITE);
 
-  displayRawText("Set Freq...", 30, 50, DISPLAY_WHITE, DISPLAY_NAVY);
-  displayRawText("Set BFO...", 30, 80, DISPLAY_WHITE, DISPLAY_NAVY);
-  displayRawText("CW Delay...", 30, 110, DISPLAY_WHITE, DISPLAY_NAVY);
-  displayRawText("CW Keyer...", 30, 140, DISPLAY_WHITE, DISPLAY_NAVY);
-  displayRawText("Touch Screen...", 30, 170, DISPLAY_WHITE, DISPLAY_NAVY);
-  displayRawText("Exit", 30, 200, DISPLAY_WHITE, DISPLAY_NAVY);
+  displayRawText(F("Set Freq..."), 30, 50, DISPLAY_WHITE, DISPLAY_NAVY);
+  displayRawText(F("Set BFO..."), 30, 80, DISPLAY_WHITE, DISPLAY_NAVY);
+  displayRawText(F("CW Delay..."), 30, 110, DISPLAY_WHITE, DISPLAY_NAVY);
+  displayRawText(F("CW Keyer..."), 30, 140, DISPLAY_WHITE, DISPLAY_NAVY);
+  displayRawText(F("Touch Screen..."), 30, 170, DISPLAY_WHITE, DISPLAY_NAVY);
+  displayRawText(F("Exit"), 30, 200, DISPLAY_WHITE, DISPLAY_NAVY);
 }
 
 static int prevPuck = -1;
@@ -240,65 +274,98 @@ void movePuck(int i) {
 
 }
 
-void doSetup2() {
-  int select = 0, i, btnState;
-
-  drawSetupMenu();
-  movePuck(select);
-
-  //wait for the button to be raised up
-  while (btnDown())
-    active_delay(50);
-  active_delay(50);  //debounce
-
-  menuOn = 2;
-
-  while (menuOn) {
-    i = enc_read();
+static int setupSelect;
+static bool setupPicked;
 
-    if (i > 0) {
-      if (select + i < 60)
-        select += i;
-      movePuck(select / 10);
-    }
-    if (i < 0 && select - i >= 0) {
-      select += i;      //caught ya, i is already -ve here, so you add it
-      movePuck(select / 10);
-    }
+static void setupMenuStep() {
+  int i;
 
-    if (!btnDown()) {
-      active_delay(50);
-      continue;
-    }
+  //wait for the button to lift off and debounce
+  if (!dialogSettled())
+    return;
 
-    //wait for the touch to lift off and debounce
-    while (btnDown()) {
-      active_delay(50);
-    }
-    active_delay(300);
-
-    if (select < 10)
+  if (setupPicked) {
+    setupPicked = false;
+    if (setupSelect < 10)
       setupFreq();
-    else if (select < 20 )
+    else if (setupSelect < 20 )
       setupBFO();
-    else if (select < 30 )
+    else if (setupSelect < 30 )
       setupCwDelay();
-    else if (select < 40)
+    else if (setupSelect < 40)
       setupKeyer();
-    else if (select < 50)
-      setupTouch();
-    else
-      break; //exit setup was chosen
-    //setupExit();
-    //redraw
-    drawSetupMenu();
+    else if (setupSelect < 50)
+      setupTouch(setupDone);
+    else {
+      //exit setup was chosen
+      dialogClose();
+      dialogPace(50);
+      guiRefresh();
+    }
+    return;
+  }
+
+  i = enc_read();
+
+  if (i > 0) {
+    if (setupSelect + i < 60)
+      setupSelect += i;
+    movePuck(setupSelect / 10);
   }
+  if (i < 0 && setupSelect + i >= 0) {
+    setupSelect += i;      //caught ya, i is already -ve here, so you add it
+    movePuck(setupSelect / 10);
+  }
+
+  if (dialogButton()) {
+    setupPicked = true;
+    dialogSettle(300);
+  }
+}
+
+static void setupMenuReturn() {
+  //redraw
+  drawSetupMenu();
+  prevPuck = -1;
+  movePuck(setupSelect / 10);
+  dialogOpen(setupMenuStep);
+  dialogSettle(50);
+}
+
+void doSetup2() {
+  setupSelect = 0;
+  setupPicked = false;
+  setupDone = setupMenuReturn;
+
+  drawSetupMenu();
+  prevPuck = -1;
+  movePuck(setupSelect);
+
+  //wait for the button to be raised up
+  dialogOpen(setupMenuStep);
+  dialogSettle(50);  //debounce
+}
+
+static void calibrateDone() {
+  dialogClose();
+  guiRefresh();
+}
 
-  //debounce the button
-  while (btnDown())
-    active_delay(50);
-  active_delay(50);
+static void calibrateBFO() {
+  isUSB = false;
+  setFrequency(7100000l);
+  setupDone = calibrateDone;
+  setupBFO();
+}
+
+static void calibrateFreq() {
+  isUSB = true;
+  setFrequency(10000000l);
+  setupDone = calibrateBFO;
+  setupFreq();
+}
 
-  checkCAT();
-  guiUpdate();
+//the calibration run at power on when the button is held: touch screen, master clock and then the BFO
+void setupCalibrate() {
+  setupTouch(calibrateFreq);
 }
@@ -0,0 +1,135 @@
+#include <Arduino.h>
+#if defined(__AVR__) || defined(UBITX_HOST)
+#include <avr/sleep.h>
+#endif
+#include "ubitx.h"
+
+/**
+ * All the timing in the sketch hangs off one hardware tick.
+ * Timer0 belongs to millis() and delay() and Timer2 to tone(), so we take Timer1
+ * and run it in CTC mode to interrupt exactly once a millisecond. The interrupt
+ * counts the ticks and samples the encoder momentum; the keyer, the CAT receive
+ * timeout and the display refresh use the software timers below.
+ *
+ * A deadline is never compared directly with the tick count, we always look at the
+ * difference. That keeps working when the count wraps after 49 days, which happens
+ * on rigs that are never switched off.
+ *
+ * The Timer1 registers and the sleep modes are the only parts tied to the ATmega328.
+ * Built for anything else, tick_setup() does nothing and timer_tick() has to be called
+ * once a millisecond by whatever stands in for the timer.
+ */
+
+static volatile uint32_t tickCount = 0;
+static uint32_t timerDeadline[MAX_TIMERS];
+static byte timerArmed = 0;   //one bit for each of the timers
+
+#ifdef __AVR__
+ISR(TIMER1_COMPA_vect)
+#else
+void timer_tick()
+#endif
+{
+  isrEnter();
+  tickCount++;
+  enc_tick();
+#ifdef __AVR__
+  //the counter starts over at the compare match, so it has counted the time since then
+  isrLeave(ISR_TICK, isrStart);
+#else
+  isrLeave(ISR_TICK, 0);
+#endif
+}
+
+void tick_setup() {
+#ifdef __AVR__
+  TCCR1A = 0;                           //no output pins
+  TCCR1B = _BV(WGM12) | _BV(CS11);      //CTC mode, clock divider of 8
+  TCNT1  = 0;
+  OCR1A  = F_CPU / 8 / 1000 - 1;        //one compare match every millisecond
+  TIMSK1 |= _BV(OCIE1A);
+#endif
+}
+
+//milliseconds since tick_setup(), the 32 bit count has to be read with the interrupts off
+uint32_t ticks() {
+  uint32_t t;
+#ifdef __AVR__
+  uint8_t sreg = SREG;
+
+  cli();
+  t = tickCount;
+  SREG = sreg;
+#else
+  noInterrupts();
+  t = tickCount;
+  interrupts();
+#endif
+  return t;
+}
+
+/**
+ * The clock cycles since tick_setup(), counted from the ticks and the Timer1 counter that
+ * runs between them. The counter moves once every 8 cycles, so that is the resolution,
+ * and the count wraps after 268 seconds: only ever look at the difference of two readings.
+ * It is the stopwatch for timing the code on the radio.
+ */
+uint32_t timerCycles() {
+  uint32_t t;
+#ifdef __AVR__
+  unsigned int count;
+  uint8_t sreg = SREG;
+
+  cli();
+  t = tickCount;
+  count = TCNT1;
+  //the counter has started over but the interrupt that counts the tick is still waiting
+  if ((TIFR1 & _BV(OCF1A)) && count < OCR1A / 2)
+    t++;
+  SREG = sreg;
+  return t * (F_CPU / 1000) + count * 8;
+#else
+  t = micros();
+  return t * (F_CPU / 1000000l);
+#endif
+}
+
+void timerStart(byte t, uint32_t ms) {
+  timerDeadline[t] = ticks() + ms;
+  timerArmed |= 1 << t;
+}
+
+void timerStop(byte t) {
+  timerArmed &= ~(1 << t);
+}
+
+bool timerRunning(byte t) {
+  return timerArmed & (1 << t);
+}
+
+//true once the tick count has gone past the deadline of a running timer
+bool timerExpired(byte t) {
+  if (!timerRunning(t))
+    return false;
+  return (int32_t)(ticks() - timerDeadline[t]) > 0;
+}
+
+/**
+ * Stops the processor until the next interrupt. In the idle mode the timers, the USART
+ * and the pin changes keep running, so the tick, a byte from the CAT port, the encoder,
+ * the function button or the PTT wake it up again, never more than a millisecond later.
+ * The touch screen and the paddle are polled, the tick wakes us up for them.
+ */
+void idleSleep() {
+#if defined(__AVR__) || defined(UBITX_HOST)
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+#endif
+}
+
+#ifdef UBITX_HOST
+//for the host build, see host/host.h: the count starts close to where it wraps around
+void tick_preset(uint32_t ms) {
+  tickCount = ms;
+}
+#endif
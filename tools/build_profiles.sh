@@ -0,0 +1,17 @@
+#!/bin/sh
+# Builds the sketch once for each profile in config.h and prints the flash and RAM it takes.
+# Needs arduino-cli with the arduino:avr core, run it from the sketch directory or pass the path.
+#   tools/build_profiles.sh [sketch directory]
+
+SKETCH=${1:-.}
+FQBN=${FQBN:-arduino:avr:nano}
+
+for profile in 1:full 2:rit 3:minimal; do
+  n=${profile%%:*}
+  name=${profile#*:}
+  printf '%-8s ' "$name"
+  arduino-cli compile --fqbn "$FQBN" \
+    --build-property "compiler.cpp.extra_flags=-DUBITX_PROFILE=$n" \
+    "$SKETCH" 2>&1 | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/flash \1/p; s/^Global variables use \([0-9]*\) bytes.*/ram \1/p' | tr '\n' ' '
+  echo
+done
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+# Records the CAT traffic between a program and the radio, and plays it back to the radio
+# to time the answers. Needs pyserial, and Linux or macOS for the recording.
+#   tools/cat_replay.py record /dev/ttyUSB0 session.txt
+#       makes a pseudo terminal for the program to use instead of the radio (its name is
+#       printed, --link puts a symlink to it), passes everything on and logs it with the time
+#   tools/cat_replay.py replay /dev/ttyUSB0 session.txt
+#       sends the program's side of a recording at the same pace and prints, for each
+#       command, how long the radio took to answer and how often it didn't
+#
+# A recording has a line for each burst of bytes: the seconds since the start, > for what
+# the program sent and < for what the radio answered, and the bytes in hex. Lines starting
+# with # are comments. ubitx_cat_replay (host/harness) plays a recording to the host build.
+import argparse
+import os
+import select
+import sys
+import time
+
+COMMANDS = {0x01: 'set freq', 0x02: 'split on', 0x82: 'split off', 0x03: 'get freq',
+            0x07: 'set mode', 0x08: 'ptt on', 0x88: 'ptt off', 0x81: 'vfo toggle',
+            0xbb: 'read eeprom', 0xe7: 'rx status', 0xf7: 'tx status'}
+
+
+def record(radio, path, link):
+    import tty
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    name = os.ttyname(slave)
+    if link:
+        if os.path.islink(link):
+            os.unlink(link)
+        os.symlink(name, link)
+    print('point the program at %s, ctrl-c to stop' % (link or name))
+
+    start = time.time()
+    with open(path, 'w') as log:
+        try:
+            while True:
+                ready, _, _ = select.select([master, radio.fileno()], [], [])
+                for fd in ready:
+                    if fd == master:
+                        data, way = os.read(master, 256), '>'
+                        radio.write(data)
+                    else:
+                        data, way = radio.read(radio.in_waiting or 1), '<'
+                        os.write(master, data)
+                    log.write('%.4f %s %s\n' % (time.time() - start, way, data.hex()))
+        except KeyboardInterrupt:
+            pass
+    if link:
+        os.unlink(link)
+
+
+def load(path):
+    """the frames the program sent, each with when it was sent and how many bytes came back"""
+    frames = []
+    pending = b''
+    with open(path) as log:
+        for line in log:
+            if line.startswith('#') or not line.strip():
+                continue
+            when, way, data = line.split()
+            data = bytes.fromhex(data)
+            if way == '>':
+                pending += data
+                while len(pending) >= 5:
+                    frames.append([float(when), pending[:5], 0])
+                    pending = pending[5:]
+            elif frames:
+                frames[-1][2] += len(data)
+    return frames
+
+
+def percentile(times, p):
+    times = sorted(times)
+    return times[min(len(times) - 1, int(len(times) * p / 100))]
+
+
+def replay(radio, path, timeout):
+    frames = load(path)
+    stats = {}
+    time.sleep(2)   # opening the port restarts the Nano
+    start = time.time()
+    radio.reset_input_buffer()
+    for when, frame, answer in frames:
+        wait = start + when - time.time()
+        if wait > 0:
+            time.sleep(wait)
+        sent = time.time()
+        radio.write(frame)
+        radio.timeout = timeout
+        got = radio.read(answer) if answer else b''
+        took = time.time() - sent
+
+        times, lost = stats.setdefault(frame[4], ([], [0]))
+        if len(got) < answer:
+            lost[0] += 1
+            radio.reset_input_buffer()
+        else:
+            times.append(took * 1000)
+
+    print('%-12s %6s %8s %8s %8s %8s' % ('command', 'count', 'p50 ms', 'p99 ms', 'max ms', 'timeouts'))
+    for command, (times, lost) in sorted(stats.items()):
+        name = COMMANDS.get(command, '%02x' % command)
+        if times:
+            print('%-12s %6d %8.1f %8.1f %8.1f %8d' % (name, len(times), percentile(times, 50),
+                  percentile(times, 99), max(times), lost[0]))
+        else:
+            print('%-12s %6d %8s %8s %8s %8d' % (name, 0, '-', '-', '-', lost[0]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Records and replays CAT sessions.')
+    parser.add_argument('mode', choices=['record', 'replay'])
+    parser.add_argument('port', help='the serial port of the radio')
+    parser.add_argument('session', help='the recording')
+    parser.add_argument('--baud', type=int, default=38400)
+    parser.add_argument('--link', help='when recording, a symlink to the pseudo terminal')
+    parser.add_argument('--timeout', type=float, default=0.5,
+                        help='when replaying, how long to wait for an answer, in seconds')
+    args = parser.parse_args()
+
+    import serial
+    with serial.Serial(args.port, args.baud, timeout=0) as radio:
+        if args.mode == 'record':
+            record(radio, args.session, args.link)
+        else:
+            replay(radio, args.session, args.timeout)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Builds the sketch and prints where its flash and RAM go, by source file and by symbol.
+# Needs arduino-cli with the arduino:avr core, and the avr-nm that comes with it on the path.
+#   tools/footprint.sh [sketch directory] [how many symbols to list]
+
+SKETCH=${1:-.}
+TOP=${2:-30}
+FQBN=${FQBN:-arduino:avr:nano}
+BUILD=${BUILD:-/tmp/ubitx-footprint}
+SYMBOLS=$BUILD/footprint.txt
+
+OUT=$(arduino-cli compile --fqbn "$FQBN" --build-path "$BUILD" "$SKETCH" 2>&1) || { echo "$OUT"; exit 1; }
+echo "$OUT" | grep -E '^(Sketch uses|Global variables use)'
+ELF=$(ls "$BUILD"/*.elf | head -n 1)
+
+# Flash holds the code, the PROGMEM tables and the starting values of the initialised
+# variables (data). RAM holds the variables, initialised or not (bss), and the stack.
+# The source file comes from the debug information, a symbol without any is put under '?'.
+avr-nm -C -S -l -t d --size-sort "$ELF" | awk -F '\t' '
+{
+  n = split($1, f, " ")
+  if (n < 4 || length(f[3]) != 1)
+    next
+  size = f[2] + 0
+  name = f[4]
+  for (i = 5; i <= n; i++)
+    name = name " " f[i]
+  module = $2
+  sub(/:[0-9]*$/, "", module)
+  sub(/.*\//, "", module)
+  if (module == "")
+    module = "?"
+
+  if (f[3] ~ /[TtWw]/)
+    where = "flash"
+  else if (f[3] ~ /[Dd]/)
+    where = "data"
+  else if (f[3] ~ /[BbVv]/)
+    where = "bss"
+  else
+    next
+  if (where != "bss")
+    flash[module] += size
+  if (where != "flash")
+    ram[module] += size
+  printf "symbol %d %s %s %s\n", size, where, module, name
+}
+END {
+  for (m in flash)
+    printf "flash %d %s\n", flash[m], m
+  for (m in ram)
+    printf "ram %d %s\n", ram[m], m
+}' > "$SYMBOLS"
+
+echo
+echo "flash by source file"
+grep '^flash ' "$SYMBOLS" | sort -k2,2nr | awk '{ printf "  %6d  %s\n", $2, $3 }'
+echo
+echo "RAM by source file"
+grep '^ram ' "$SYMBOLS" | sort -k2,2nr | awk '{ printf "  %6d  %s\n", $2, $3 }'
+echo
+echo "the $TOP biggest symbols"
+grep '^symbol ' "$SYMBOLS" | sort -k2,2nr | head -n "$TOP" |
+  awk '{ name = $5; for (i = 6; i <= NF; i++) name = name " " $i; printf "  %6d  %-5s  %-20s %s\n", $2, $3, $4, name }'
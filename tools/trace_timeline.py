@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+# Reads the event trace from the radio over the CAT port and prints it as a timeline.
+# The sketch has to be built with TRACE set to 1 in trace.h. Needs pyserial.
+#   tools/trace_timeline.py /dev/ttyUSB0
+#   tools/trace_timeline.py --file dump.bin    decodes a dump saved earlier with --save
+import argparse
+import struct
+import sys
+
+CAT_TRACE = b'\x00\x00\x00\x00\xd2'
+
+TX_MODES = {0: 'ssb', 1: 'cw'}
+KEYER_STATES = ['idle', 'check dit', 'check dah', 'keyed prep', 'keyed', 'inter element']
+CAT_COMMANDS = {0x01: 'set freq', 0x02: 'split on', 0x82: 'split off', 0x03: 'get freq',
+                0x07: 'set mode', 0x08: 'ptt on', 0x88: 'ptt off', 0x81: 'vfo toggle',
+                0xbb: 'read eeprom', 0xe7: 'rx status',
+                0xf7: 'tx status', 0xd0: 'histogram', 0xd1: 'diag reset', 0xd2: 'trace',
+                0xd3: 'bus counts', 0xd4: 'isr times',
+                0xd5: 'stack', 0xd6: 'cat times',
+                0xd7: 'cw timing'}
+
+
+def flags(data):
+    names = [name for bit, name in ((1, 'usb'), (2, 'cw'), (4, 'tx')) if data & bit]
+    return ' '.join(names) if names else 'lsb'
+
+
+def describe(event, data, value):
+    if event == 1:
+        return 'tx start  %s at %d kHz' % (TX_MODES.get(data, data), value)
+    if event == 2:
+        return 'tx stop'
+    if event == 3:
+        return 'frequency %d kHz, %s' % (value, flags(data))
+    if event == 4:
+        name = CAT_COMMANDS.get(data, 'command %02x' % data)
+        return 'cat       %s (%02x %02x)' % (name, value >> 8, value & 0xff)
+    if event == 5:
+        state = KEYER_STATES[data] if data < len(KEYER_STATES) else str(data)
+        return 'keyer     %s' % state
+    if event == 6:
+        return 'eeprom    %d bytes at %d' % (data, value)
+    if event == 7:
+        return 'i2c error %d writing register %d' % (data, value)
+    if event == 8:
+        return 'tx hold   refused a retune out of the bands to %d kHz' % value
+    return 'event %d  %d %d' % (event, data, value)
+
+
+def decode(dump):
+    now, count = struct.unpack_from('<HB', dump)
+    entries = [struct.unpack_from('<HBBH', dump, 3 + 6 * i) for i in range(count)]
+    if not entries:
+        print('the trace is empty')
+        return
+
+    # the times are 16 bit msec, walk back from now to lay them out in order
+    ages = [(now - time) & 0xffff for time, _, _, _ in entries]
+    start = ages[0]
+    for (time, event, data, value), age in zip(entries, ages):
+        print('%8.3f s  %s' % ((start - age) / 1000.0, describe(event, data, value)))
+    print('%8.3f s  now' % (start / 1000.0))
+
+
+def read_radio(port, baud):
+    import serial
+    with serial.Serial(port, baud, timeout=2) as s:
+        s.reset_input_buffer()
+        s.write(CAT_TRACE)
+        header = s.read(3)
+        if len(header) < 3:
+            sys.exit('no answer, is the sketch built with TRACE set to 1?')
+        return header + s.read(6 * header[2])
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Prints the event trace of the radio.')
+    parser.add_argument('port', nargs='?', help='the serial port of the radio')
+    parser.add_argument('--baud', type=int, default=38400)
+    parser.add_argument('--file', help='decode a saved dump instead of reading the radio')
+    parser.add_argument('--save', help='also save the dump to this file')
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file, 'rb') as f:
+            dump = f.read()
+    elif args.port:
+        dump = read_radio(args.port, args.baud)
+    else:
+        parser.error('give the serial port or --file')
+
+    if args.save:
+        with open(args.save, 'wb') as f:
+            f.write(dump)
+    decode(dump)
+
+
+if __name__ == '__main__':
+    main()
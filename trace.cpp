@@ -0,0 +1,59 @@
+#include <Arduino.h>
+#include "ubitx.h"
+#include "trace.h"
+
+/**
+ * The event trace, see trace.h.
+ *
+ * The CAT command 00 00 00 00 D2 sends the ring, oldest entry first:
+ *
+ *   2 bytes   the time now
+ *   1 byte    how many entries follow
+ *   6 bytes   for each entry: the time (2 bytes), the event, the data byte, the value (2 bytes)
+ *
+ * The times are the low 16 bits of ticks(), in msec, and the numbers are low byte first.
+ * They wrap every 65 seconds, the time now lets the reader tell how long ago each one was.
+ */
+#if TRACE
+
+//fixed widths, so the 6 bytes are the same on the Nano and the host build
+struct TraceEntry {
+  uint16_t time;
+  byte event;
+  byte data;
+  uint16_t value;
+};
+
+static struct TraceEntry traceRing[TRACE_ENTRIES];
+static byte traceNext = 0;    //where the next entry goes
+static bool traceFull = false;
+
+void traceEvent(byte event, byte data, uint16_t value) {
+  struct TraceEntry *entry = traceRing + traceNext;
+
+  entry->time = ticks();
+  entry->event = event;
+  entry->data = data;
+  entry->value = value;
+
+  if (++traceNext == TRACE_ENTRIES) {
+    traceNext = 0;
+    traceFull = true;
+  }
+}
+
+void traceSend() {
+  uint16_t now = ticks();
+  byte count = traceFull ? TRACE_ENTRIES : traceNext;
+  byte oldest = traceFull ? traceNext : 0;
+
+  Serial.write((byte *)&now, sizeof(now));
+  Serial.write(count);
+  for (byte i = 0; i < count; i++) {
+    Serial.write((byte *)(traceRing + oldest), sizeof(struct TraceEntry));
+    if (++oldest == TRACE_ENTRIES)
+      oldest = 0;
+  }
+}
+
+#endif
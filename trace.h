@@ -0,0 +1,49 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <EEPROM.h>
+
+/**
+ * A record of the last things the radio did, for when it is reported to have hung in tx
+ * or done something odd. Set TRACE to 1 and every event below is written into a ring of
+ * TRACE_ENTRIES entries with the time it happened, the oldest is overwritten when it is full.
+ * The ring is read over the CAT port (command D2, see trace.cpp) and tools/trace_timeline.py
+ * prints it as a timeline.
+ *
+ * Each entry takes 6 bytes of RAM, the ring 384. With TRACE at 0, trace() is empty and
+ * nothing is kept.
+ */
+#ifndef TRACE
+#define TRACE 0
+#endif
+#define TRACE_ENTRIES 64
+
+//the events, and what goes into their data byte and value
+#define TRACE_TX_START  1 // the tx mode, the frequency in kHz
+#define TRACE_TX_STOP   2
+#define TRACE_FREQ      3 // the TRACE_FLAG_ bits, the frequency in kHz
+#define TRACE_CAT       4 // the command, its first two bytes
+#define TRACE_KEYER     5 // the state the keyer went to
+#define TRACE_EEPROM    6 // how many bytes, the address
+#define TRACE_I2C_ERROR 7 // what Wire.endTransmission() returned, the register
+#define TRACE_TX_BOUNDS 8 // a retune out of the bands refused while transmitting, the frequency in kHz
+
+#define TRACE_FLAG_USB  0x01
+#define TRACE_FLAG_CW   0x02
+#define TRACE_FLAG_TX   0x04
+
+#if TRACE
+void traceEvent(byte event, byte data, uint16_t value);
+void traceSend();
+#define trace(event, data, value) traceEvent(event, data, value)
+#else
+#define trace(event, data, value) do {} while (0)
+#endif
+
+//all the writes to the EEPROM go through here, so they can be traced
+template <typename T> inline void eepromPut(int address, const T &value) {
+  trace(TRACE_EEPROM, sizeof(T), address);
+  EEPROM.put(address, value);
+}
+
+#endif
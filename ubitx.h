@@ -7,6 +7,8 @@
    20220114 - Add bandSelectOn.
 */
 
+#include "config.h"
+
 /* The ubitx is powered by an arduino nano. The pin assignment is as follows
 
 */
@@ -63,12 +65,11 @@
    created in a memory region called the stack. The stack has just a few bytes of space on the Arduino
    if you declare large strings inside functions, they can easily exceed the capacity of the stack
    and mess up your programs.
-   We circumvent this by declaring a few global buffers as  kitchen counters where we can
-   slice and dice our strings. These strings are mostly used to control the display or handle
+   We circumvent this with a small arena where functions lease the bytes to
+   slice and dice our strings, see scratch.h. These strings are mostly used to control the display or handle
    the input and output from the USB port. We must keep a count of the bytes used while reading
    the serial port as we can easily run out of buffer space. This is done in the serial_in_count variable.
 */
-extern char c[30], b[30];
 //extern char printBuff[2][20];  //mirrors what is showing on the two lines of the display
 //extern int count;          //to generally count ticks, loops, etc
 
@@ -150,14 +151,21 @@ extern char c[30], b[30];
 #define TX_SSB 0
 #define TX_CW 1
 
+#if FEATURE_BAND_SELECT
 extern bool bandSelectOn; // N8LOV - true indicates band selection mode is on (active)
+#else
+#define bandSelectOn false  //never on, the band selection calls drop out when compiling
+#endif
 extern bool inhibitTx; // N8LOV - true is inhibit/ false is don't inhibit
+#if FEATURE_RIT
 extern bool ritOn;
+extern uint32_t ritRxFrequency, ritTxFrequency;
+#endif
 extern char vfoActive;
-extern unsigned long vfoA, vfoB, sideTone, usbCarrier;
+extern uint32_t vfoA, vfoB, sideTone, usbCarrier;
 extern bool isUsbVfoA, isUsbVfoB;
-extern unsigned long frequency  /* -RIT , ritRxFrequency, ritTxFrequency  -RIT */;  //frequency is the current frequency on the dial
-extern unsigned long firstIF;
+extern uint32_t frequency;  //frequency is the current frequency on the dial
+extern uint32_t firstIF;
 
 // if cwMode is flipped on, the rx frequency is tuned down by sidetone hz instead of being zerobeat
 extern bool cwMode; // N8LOV - the current cwMode
@@ -183,13 +191,16 @@ extern bool doingCAT;
 extern bool txCAT;        //turned on if the transmitting due to a CAT command
 extern bool inTx;                //it is set to 1 if in transmit mode (whatever the reason : cw, ptt or cat)
 extern bool splitOn;             //working split, uses VFO B as the transmit frequency
+#if FEATURE_UI_EXTRAS
 extern bool oneKhzOn; // N8LOV - true sets frequency adjustment by 1khz using knob (to support split freq)/ false is normal frequency adjustment by knob
+#else
+#define oneKhzOn false
+#endif
 extern bool keyDown;             //in cw mode, denotes the carrier is being transmitted
 extern bool isUSB;               //upper sideband was selected, this is reset to the default for the
 //frequency when it crosses the frequency border of 10 MHz
 extern byte menuOn;              //set to 1 when the menu is being displayed, if a menu item sets it to zero, the menu is exited
-extern unsigned long cwTimeout;  //milliseconds to go before the cw transmit line is released and the radio goes back to rx mode
-extern unsigned long dbgCount;   //not used now
+extern uint32_t dbgCount;   //not used now
 extern unsigned char txFilter ;   //which of the four transmit filters are in use
 extern bool modeCalibrate;//this mode of menus shows extended menus to calibrate the oscillators and choose the proper
 //beat frequency
@@ -199,15 +210,18 @@ void active_delay(int delay_by);
 //void saveVFOs();
 void saveVFO(); // N8LOV - save active VFO info to EEPROM
 void recallVFO();  // N8LOV - recall the active VFO info from EEPROM
-void setFrequency(unsigned long f);
+void setFrequency(uint32_t f);
 void startTx(byte txMode);
 void stopTx();
-/* -RIT
-void ritEnable(unsigned long f);
+#if FEATURE_RIT
+void ritEnable(uint32_t f);
 void ritDisable();
--RIT */
+#endif
 void checkCAT();
+uint32_t readFreq(byte* cmd);           //the BCD frequency of a CAT command in Hz, in ubitx_cat.cpp
+void writeFreq(uint32_t freq,byte* cmd); //and the other way around
 void cwKeyer(void);
+char update_PaddleLatch(byte isUpdateKeyState); //reads the paddle, in keyer.cpp
 void switchVFO(int vfoSelect);
 
 int enc_read(void); // returns the number of ticks in a short interval, +ve in clockwise, -ve in anti-clockwise
@@ -240,38 +254,292 @@ int btnDown(); //returns true if the encoder button is pressed
 #define BTN_H (36)
 //
 #define FULL_W (320)
+#define FULL_H (240)
 
 
 
 /* these functions are called universally to update the display */
 void updateDisplay(); //updates just the VFO frequency to show what is in 'frequency' variable
 void redrawVFOs();    //redraws only the changed digits of the vfo
-void guiUpdate();     //repaints the entire screen. Slow!!
+void guiUpdate();     //repaints the entire screen, for the start up when what is on it isn't known. Slow!!
+//or the screen in pieces: guiPaintVFOs() clears it and paints the vfos, then each call to
+//guiPaintStep() paints one button or the status bar. It returns true when the last piece is done.
+void guiPaintVFOs();
+bool guiPaintStep();
+void guiRefresh();    //draws again just the buttons whose setting changed, and the changed digits of the vfos
+void guiDirty(int x, int y, int w, int h);  //a dialog drew there, the next guiRefresh() paints the main screen back
 void clearCommandbar(); // N8LOV
 void drawCommandbar(char *text);
+void drawCommandbar(const __FlashStringHelper *text);
 void drawTx();
+/**
+   The dialogs don't run their own loops, they are state machines. The open dialog's step function
+   is called once on every pass through loop() in place of the tuning, button and touch checks,
+   so the keyer, the PTT and CAT carry on while a menu is on the screen.
+   A step function returns at once if it has nothing to do. dialogSettle() pauses the dialog until
+   the button has been released and the given milliseconds have passed, dialogSettled() tells if it may go on.
+   dialogPace() is the pause after a knob step: a new press ends it at once and is kept, dialogButton()
+   reads it or else the button, so a quick press isn't lost while the dialog waits.
+*/
+typedef void (*DialogStep)(void);
+extern DialogStep dialogStep;   //the step function of the open dialog, NULL when none is open
+void dialogOpen(DialogStep step);
+void dialogClose();
+void dialogSettle(unsigned int ms);
+void dialogPace(unsigned int ms);
+bool dialogSettled();
+bool dialogButton();
+
 //getValueByKnob() provides a reusable dialog box to get a value from the encoder, the prefix and postfix
-//are useful to concatanate the values with text like "Set Freq to " x " KHz"
-int getValueByKnob(int minimum, int maximum, int step_size,  int initial, char* prefix, char *postfix);
+//are useful to concatanate the values with text like "Set Freq to " x " KHz", they are PSTR() strings in the flash
+//it returns at once, done() is called with the value when the user presses the button or touches the screen
+void getValueByKnob(int minimum, int maximum, int step_size,  int initial, PGM_P prefix, PGM_P postfix, void (*done)(int value));
 
 //functions of the setup menu. implemented in setup.cpp
 void doSetup2(); //main setup function, displays the setup menu, calls various dialog boxes
 void setupBFO();
 void setupFreq();
+void setupCalibrate(); //runs the touch, frequency and bfo calibration one after the other, used at power up
 
 
 
 //displays a nice dialog box with a title and instructions as footnotes
-void displayDialog(char *title, char *instructions);
-void printCarrierFreq(unsigned long freq); //used to display the frequency in the command area (ex: fast tuning)
+void displayDialog(const __FlashStringHelper *title, const __FlashStringHelper *instructions);
+void printCarrierFreq(uint32_t freq); //used to display the frequency in the command area (ex: fast tuning)
+void displayVFO(int vfo);                  //repaints the digits of the vfo that have changed
+void formatFreq(int32_t f, char *buff);       //the frequency as kHz with two decimals, 8 characters and the terminating zero
+
+//set BENCHMARKS to 1 to time the busiest routines at power up, they are printed on the serial port. See bench.cpp
+#ifndef BENCHMARKS
+#define BENCHMARKS 0
+#endif
+void runBenchmarks();
 
 void enc_setup(void);
 int enc_read(void);
+bool enc_activity(void); //true if the encoder, the function button or the PTT pins have changed since the last call
+void enc_tick(void); //called from the tick interrupt every millisecond to sample the encoder momentum
+#if BENCHMARKS
+void enc_edge_bench(bool step); //the encoder interrupt's work for an edge, a step or one that changes nothing
+#endif
+
+/* these are the functions implemented in bcd.cpp */
+// the frequency as eight packed BCD digits, 0x14285000 is 14.285 MHz. See bcd.cpp
+uint32_t bcdFromBinary(uint32_t n);
+uint32_t bcdAdd(uint32_t a, uint32_t b);
+uint32_t bcdSubtract(uint32_t a, uint32_t b);
+void bcdTune(uint32_t f);         //keeps the BCD copy of the tuned frequency, called by setFrequency()
+uint32_t bcdFrequency(uint32_t f); //the BCD of f, without converting it again if it is the tuned frequency
+
+/* these are the functions implemented in timer.cpp */
+// the software timers, all of them count in milliseconds of the Timer1 tick
+#define TIMER_CW      0 // the cw hang time before the radio goes back to rx
+#define TIMER_KEYER   1 // the end of the current keyer element or space
+#define TIMER_CAT_RX  2 // drops a CAT command that arrives incomplete
+#define TIMER_DISPLAY 3 // limits how often the vfo is repainted while tuning
+#define TIMER_DIALOG  4 // debounces the button and paces the open dialog
+#define TIMER_IDLE    5 // switches the display off when the radio is left alone
+#define MAX_TIMERS    6
+
+void tick_setup();
+uint32_t ticks();
+uint32_t timerCycles(); //clock cycles, 8 at a time, wraps after 268 seconds. For timing the code
+void timerStart(byte t, uint32_t ms);
+void timerStop(byte t);
+bool timerRunning(byte t);
+bool timerExpired(byte t);
+void idleSleep();  //sleeps until the next interrupt, at most a millisecond
+#ifndef __AVR__
+void timer_tick(); //stands in for the Timer1 interrupt when built for anything but the AVR, see timer.cpp
+#endif
+
+/* these are the functions implemented in diag.cpp */
+//set DIAG_HISTOGRAMS to 1 to keep histograms of how long the stages of loop() take, read over CAT. See diag.cpp
+#ifndef DIAG_HISTOGRAMS
+#define DIAG_HISTOGRAMS 0
+#endif
+
+#define DIAG_LOOP     0 // a whole pass through loop(), without the sleep at the end
+#define DIAG_KEYER    1
+#define DIAG_PTT      2
+#define DIAG_SCREEN   3 // the open dialog, or painting the rest of the screen after power up
+#define DIAG_BUTTON   4
+#define DIAG_TUNING   5 // the knob, or the RIT
+#define DIAG_TOUCH    6
+#define DIAG_CAT      7
+#define DIAG_KNOB_RIG 8 // from a step of the knob to the oscillators being retuned, in cycles / 256
+#define DIAG_KNOB_LCD 9 // from a step of the knob to the new frequency drawn, in cycles / 256
+#define DIAG_STAGES   10
+#define DIAG_BINS     10
+
+#if DIAG_HISTOGRAMS
+void diagRecord(byte stage, uint32_t cycles);
+uint32_t diagLapTime(byte stage, uint32_t since);
+void diagSend(byte stage);
+//diagBegin(t) starts a stopwatch t, diagLap() puts the time since then into the stage and starts it again
+#define diagBegin(t) uint32_t t = timerCycles()
+#define diagLap(stage, t) (t = diagLapTime(stage, t))
+#define diagRestart(t) (t = timerCycles())
+uint32_t enc_step_time(void);
+void diagKnobTuned(uint32_t stepAt);
+void diagKnobShown();
+//diagStepTime(t) keeps when the steps the next enc_read() returns began, before reading them
+#define diagStepTime(t) uint32_t t = enc_step_time()
+#else
+#define diagBegin(t)
+#define diagLap(stage, t)
+#define diagRestart(t)
+#define diagStepTime(t)
+#define diagKnobTuned(t)
+#define diagKnobShown()
+#endif
+
+//set DIAG_BUS to 1 to count the bytes and the time on the SPI and I2C buses by where they are used, read over CAT
+#ifndef DIAG_BUS
+#define DIAG_BUS 0
+#endif
+
+#define BUS_OTHER     0 // anything outside the sites below
+#define BUS_QUICKFILL 1
+#define BUS_CHAR      2 // displayChar()
+#define BUS_ADDRESS   3 // utftAddress(), setting the display window
+#define BUS_PIXEL     4
+#define BUS_TOUCH     5 // reading the touch screen
+#define BUS_SI5351    6 // si5351bx_setfreq(), on the I2C bus
+#define BUS_SITES     7
+
+#if DIAG_BUS
+struct BusStats {
+  uint32_t bytes;
+  uint16_t entries;
+  uint16_t selects;  //chip selects pulled down
+  uint32_t cycles;
+  uint32_t pixels;  //written to the display
+};
+extern struct BusStats busStats[BUS_SITES];
+extern byte busSite;
+byte busSiteEnter(byte site);
+void busSiteLeave(byte outer);
+void busSend(byte site);
+//busEnter() and busLeave() go at the start and the end of a site, in the same block
+#define busEnter(site) byte busOuter = busSiteEnter(site)
+#define busLeave() busSiteLeave(busOuter)
+#define busBytes(n) (busStats[busSite].bytes += (n))
+#define busSelect() (busStats[busSite].selects++)
+#define busPixels(n) (busStats[busSite].pixels += (n))
+#else
+#define busEnter(site)
+#define busLeave()
+#define busBytes(n)
+#define busSelect()
+#define busPixels(n)
+#endif
+
+//set DIAG_ISR to 1 to time the tick and the encoder interrupts, read over CAT. See diag.cpp
+#ifndef DIAG_ISR
+#define DIAG_ISR 0
+#endif
+
+#define ISR_TICK      0 // TIMER1_COMPA, the millisecond tick and the encoder momentum
+#define ISR_ENCODER   1 // PCINT1, the encoder, the function button and the PTT
+#define ISR_VECTORS   2
+
+#if DIAG_ISR
+struct IsrStats {
+  uint32_t count;
+  uint32_t latency;    //the sums, in Timer1 counts of 8 cycles
+  uint32_t duration;
+  uint16_t latencyMax;
+  uint16_t durationMax;
+  uint16_t missed;      //encoder steps that came too fast to be told apart
+};
+extern struct IsrStats isrStats[ISR_VECTORS];
+void isrRecord(byte vector, uint16_t start, uint16_t latency);
+void isrSend(byte vector);
+#ifdef __AVR__
+#define isrClock() TCNT1
+#else
+#define isrClock() ((uint16_t)(micros() * 2))
+#endif
+//isrEnter() goes first in the interrupt, isrLeave() last, in the same block
+#define isrEnter() uint16_t isrStart = isrClock()
+#define isrLeave(vector, latency) isrRecord(vector, isrStart, latency)
+#define isrMissed(vector) (isrStats[vector].missed++)
+#else
+#define isrEnter()
+#define isrLeave(vector, latency)
+#define isrMissed(vector)
+#endif
+
+//set DIAG_CAT_COMMANDS to 1 to time the CAT commands and count the frames lost, read over CAT. See diag.cpp
+#ifndef DIAG_CAT_COMMANDS
+#define DIAG_CAT_COMMANDS 0
+#endif
+#define CAT_STATS_COMMANDS 12   //how many different commands are timed, the first ones seen
+
+#if DIAG_CAT_COMMANDS
+struct CatStats {
+  byte command;
+  uint16_t count;
+  uint32_t cycles;   //the sum
+  uint32_t worst;
+};
+void catStatsArrived();              //a byte of a frame is waiting, the first one starts the clock
+void catStatsDone(byte command);     //the reply has been sent
+void catStatsTimeout();              //the rest of the frame never came, it was thrown away
+void catStatsDropped();              //a whole frame was thrown away
+void catStatsSend(byte index);
+#else
+#define catStatsArrived()
+#define catStatsDone(command) ((void)(command))
+#define catStatsTimeout()
+#define catStatsDropped()
+#endif
+
+//set DIAG_CW_TIMING to 1 to measure how far the iambic keyer is off the ideal timing, read over CAT. See diag.cpp
+#ifndef DIAG_CW_TIMING
+#define DIAG_CW_TIMING 0
+#endif
+
+#define CW_DIT    0
+#define CW_DAH    1
+#define CW_SPACE  2 // between the dits and dahs of a character
+#define CW_KINDS  3
+
+#if DIAG_CW_TIMING
+void cwTimingDown();            //the key has just gone down
+void cwTimingUp(unsigned ms);   //and back up, after an element meant to be ms long
+void cwTimingSend(byte kind);
+#else
+#define cwTimingDown()
+#define cwTimingUp(ms)
+#endif
+
+//set DIAG_STACK to 1 to find out how close the stack has come to the variables, read over CAT. See diag.cpp
+#ifndef DIAG_STACK
+#define DIAG_STACK 0
+#endif
+
+#if DIAG_STACK
+void stackPaint();
+uint16_t stackUnused();
+void stackSend();
+#endif
+
+#if DIAG_HISTOGRAMS || DIAG_BUS || DIAG_ISR || DIAG_CAT_COMMANDS || DIAG_CW_TIMING
+void diagReset();   //clears the histograms and all the counts
+#endif
+
+//minutes without the knob, the button, the PTT or the touch screen being used before the display
+//is put to sleep. 0 keeps it on. The backlight is wired to the supply, so this only saves the
+//controller's current and the noise of its scanning.
+#define DISPLAY_SLEEP_AFTER 0
 
 //main functions to check if any button is pressed and other user interface events
 void doCommands();  //does the commands with encoder to jump from button to button
 void  checkTouch(); //does the commands with a touch on the buttons
-void setBandFreq(unsigned long, int); // sets the frequency when in band selection mode
+bool uiIdle();      //puts the display to sleep when left alone and wakes it up, true while it is asleep
+void setBandFreq(uint32_t, int); // sets the frequency when in band selection mode
 void toggleBandSelect();
 
 
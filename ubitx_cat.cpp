@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include "ubitx.h"
 #include "nano_gui.h"
+#include "trace.h"
 
 /**
  * The CAT protocol is used by many radios to provide remote control to comptuers through
@@ -13,12 +14,10 @@
  * it gives time out error with WSJTX 1.8.0  
  */
 
-static unsigned long rxBufferArriveTime = 0;
 static byte rxBufferCheckCount = 0;
 #define CAT_RECEIVE_TIMEOUT 500
 static byte cat[5]; 
 static byte insideCat = 0; 
-static byte useOpenRadioControl = 0;
 
 //for broken protocol
 #define CAT_RECEIVE_TIMEOUT 500
@@ -35,21 +34,17 @@ static byte useOpenRadioControl = 0;
 
 #define ACK 0
 
-unsigned int skipTimeCount = 0;
-
-byte setHighNibble(byte b,byte v) {
-  // Clear the high nibble
-  b &= 0x0f;
-  // Set the high nibble
-  return b | ((v & 0x0f) << 4);
-}
+//our own commands, outside the FT-817 set, for reading the diagnostics. See diag.cpp
+#define CAT_DIAG_HISTOGRAM      0xD0
+#define CAT_DIAG_RESET          0xD1
+#define CAT_TRACE               0xD2
+#define CAT_DIAG_BUS            0xD3
+#define CAT_DIAG_ISR            0xD4
+#define CAT_DIAG_STACK          0xD5
+#define CAT_DIAG_COMMANDS       0xD6
+#define CAT_DIAG_CW             0xD7
 
-byte setLowNibble(byte b,byte v) {
-  // Clear the low nibble
-  b &= 0xf0;
-  // Set the low nibble
-  return b | (v & 0x0f);
-}
+unsigned int skipTimeCount = 0;
 
 byte getHighNibble(byte b) {
   return (b >> 4) & 0x0f;
@@ -59,35 +54,17 @@ byte getLowNibble(byte b) {
   return b & 0x0f;
 }
 
-// Takes a number and produces the requested number of decimal digits, staring
-// from the least significant digit.  
-//
-void getDecimalDigits(unsigned long number,byte* result,int digits) {
-  for (int i = 0; i < digits; i++) {
-    // "Mask off" (in a decimal sense) the LSD and return it
-    result[i] = number % 10;
-    // "Shift right" (in a decimal sense)
-    number /= 10;
-  }
-}
-
 // Takes a frequency and writes it into the CAT command buffer in BCD form.
 //
-void writeFreq(unsigned long freq,byte* cmd) {
-  // Convert the frequency to a set of decimal digits. We are taking 9 digits
-  // so that we can get up to 999 MHz. But the protocol doesn't care about the
-  // LSD (1's place), so we ignore that digit.
-  byte digits[9];
-  getDecimalDigits(freq,digits,9);
-  // Start from the LSB and get each nibble 
-  cmd[3] = setLowNibble(cmd[3],digits[1]);
-  cmd[3] = setHighNibble(cmd[3],digits[2]);
-  cmd[2] = setLowNibble(cmd[2],digits[3]);
-  cmd[2] = setHighNibble(cmd[2],digits[4]);
-  cmd[1] = setLowNibble(cmd[1],digits[5]);
-  cmd[1] = setHighNibble(cmd[1],digits[6]);
-  cmd[0] = setLowNibble(cmd[0],digits[7]);
-  cmd[0] = setHighNibble(cmd[0],digits[8]);  
+void writeFreq(uint32_t freq,byte* cmd) {
+  // The BCD frequency is already in nibbles, from 10 MHz down to the Hz. The protocol
+  // counts in tens of Hz from 100 MHz, so it is shifted down by one digit, the 100 MHz
+  // digit is always 0 on this radio.
+  uint32_t bcd = bcdFrequency(freq) >> 4;
+  cmd[3] = bcd;
+  cmd[2] = bcd >> 8;
+  cmd[1] = bcd >> 16;
+  cmd[0] = bcd >> 24;
 }
 
 // This function takes a frquency that is encoded using 4 bytes of BCD
@@ -95,7 +72,7 @@ void writeFreq(unsigned long freq,byte* cmd) {
 //
 // [12][34][56][78] = 123.45678? Mhz
 //
-unsigned long readFreq(byte* cmd) {
+uint32_t readFreq(byte* cmd) {
     // Pull off each of the digits
     byte d7 = getHighNibble(cmd[0]);
     byte d6 = getLowNibble(cmd[0]);
@@ -106,14 +83,14 @@ unsigned long readFreq(byte* cmd) {
     byte d1 = getHighNibble(cmd[3]);
     byte d0 = getLowNibble(cmd[3]); 
     return  
-      (unsigned long)d7 * 100000000L +
-      (unsigned long)d6 * 10000000L +
-      (unsigned long)d5 * 1000000L + 
-      (unsigned long)d4 * 100000L + 
-      (unsigned long)d3 * 10000L + 
-      (unsigned long)d2 * 1000L + 
-      (unsigned long)d1 * 100L + 
-      (unsigned long)d0 * 10L; 
+      (uint32_t)d7 * 100000000L +
+      (uint32_t)d6 * 10000000L +
+      (uint32_t)d5 * 1000000L + 
+      (uint32_t)d4 * 100000L + 
+      (uint32_t)d3 * 10000L + 
+      (uint32_t)d2 * 1000L + 
+      (uint32_t)d1 * 100L + 
+      (uint32_t)d0 * 10L; 
 }
 
 //void ReadEEPRom_FT817(byte fromType)
@@ -267,7 +244,7 @@ void catReadEEPRom(void)
 
 void processCATCommand2(byte* cmd) {
   byte response[5];
-  unsigned long f;
+  uint32_t f;
   
   switch(cmd[4]){
 /*  case 0x00:
@@ -277,9 +254,12 @@ void processCATCommand2(byte* cmd) {
 */    
   case 0x01:
     //set frequency
+    //not while transmitting, the oscillators are set up for it: CW has CLK1 off and CLK2 on the carrier
     f = readFreq(cmd);
-    setFrequency(f);   
-    updateDisplay();
+    if (!inTx) {
+      setFrequency(f);
+      updateDisplay();
+    }
     response[0]=0;
     Serial.write(response, 1);
     //sprintf(b, "set:%ld", f); 
@@ -287,12 +267,18 @@ void processCATCommand2(byte* cmd) {
     break;
 
   case 0x02:
-    //split on 
+    //split on, like the FT-817 answer F0 if it already was, hamlib waits for the answer
+    response[0] = splitOn ? 0xf0 : 0;
     splitOn =  true;
+    Serial.write(response, 1);
+    guiRefresh();
     break;
   case 0x82:
     //split off
+    response[0] = splitOn ? 0 : 0xf0;
     splitOn = 0;
+    Serial.write(response, 1);
+    guiRefresh();
     break;
     
   case 0x03:
@@ -314,14 +300,14 @@ void processCATCommand2(byte* cmd) {
     Serial.write(response, 1);
     setFrequency(frequency);
       //printLine2("cat: mode changed");
-    //updateDisplay();
+    guiRefresh();
     break;   
  
   case 0x08: // PTT On
     if (!inTx) {
       response[0] = 0;
-      txCAT = true;
       startTx(TX_SSB);
+      txCAT = inTx;   //not if the frequency is out of the TX bands, the PTT would stay ignored
       updateDisplay();
     } else {
       response[0] = 0xf0;
@@ -331,10 +317,9 @@ void processCATCommand2(byte* cmd) {
     break;
 
   case 0x88 : //PTT OFF
-    if (inTx) {
+    if (inTx)
       stopTx();
-      txCAT = false;
-    }
+    txCAT = false;
     response[0] = 0;
     Serial.write(response,1);
     updateDisplay();
@@ -366,7 +351,7 @@ void processCATCommand2(byte* cmd) {
   case 0xf7:
     {
       boolean isHighSWR = false;
-      boolean isSplitOn = false;
+      boolean isSplitOn = splitOn;  //hamlib reads the split from here while transmitting
   
       /*
         Inverted -> *ptt = ((p->tx_status & 0x80) == 0); <-- souce code in ft817.c (hamlib)
@@ -381,13 +366,57 @@ void processCATCommand2(byte* cmd) {
     }
     break;
     
+#if DIAG_HISTOGRAMS
+  case CAT_DIAG_HISTOGRAM:
+    diagSend(cmd[0]);
+    break;
+#endif
+
+#if DIAG_BUS
+  case CAT_DIAG_BUS:
+    busSend(cmd[0]);
+    break;
+#endif
+
+#if DIAG_ISR
+  case CAT_DIAG_ISR:
+    isrSend(cmd[0]);
+    break;
+#endif
+
+#if DIAG_STACK
+  case CAT_DIAG_STACK:
+    stackSend();
+    break;
+#endif
+
+#if DIAG_CAT_COMMANDS
+  case CAT_DIAG_COMMANDS:
+    catStatsSend(cmd[0]);
+    break;
+#endif
+
+#if DIAG_CW_TIMING
+  case CAT_DIAG_CW:
+    cwTimingSend(cmd[0]);
+    break;
+#endif
+
+#if DIAG_HISTOGRAMS || DIAG_BUS || DIAG_ISR || DIAG_CAT_COMMANDS || DIAG_CW_TIMING
+  case CAT_DIAG_RESET:
+    diagReset();
+    response[0] = ACK;
+    Serial.write(response[0]);
+    break;
+#endif
+
+#if TRACE
+  case CAT_TRACE:
+    traceSend();
+    break;
+#endif
+
   default:
-    //somehow, get this to print the four bytes
-    ultoa(*((unsigned long *)cmd), c, 16);
-    /*itoa(cmd[4], b, 16);
-    strcat(b, ">");
-    strcat(b, c);
-    printLine2(b);*/
     response[0] = 0x00;
     Serial.write(response[0]);
   }
@@ -397,26 +426,35 @@ void processCATCommand2(byte* cmd) {
 
 int catCount = 0;
 void checkCAT(){
-  byte i;
+  byte i, command;
+
+  //without CAT the port is left alone and the rest of this file drops out of the image
+  if (!FEATURE_CAT)
+    return;
 
   //Check Serial Port Buffer
   if (Serial.available() == 0) {      //Set Buffer Clear status
     rxBufferCheckCount = 0;
+    timerStop(TIMER_CAT_RX);
     return;
   }
-  else if (Serial.available() < 5) {                         //First Arrived
+
+  catStatsArrived();
+  if (Serial.available() < 5) {                              //First Arrived
     if (rxBufferCheckCount == 0){
       rxBufferCheckCount = Serial.available();
-      rxBufferArriveTime = millis() + CAT_RECEIVE_TIMEOUT;  //Set time for timeout
+      timerStart(TIMER_CAT_RX, CAT_RECEIVE_TIMEOUT);        //Set time for timeout
     }
-    else if (rxBufferArriveTime < millis()){                //Clear Buffer
+    else if (timerExpired(TIMER_CAT_RX)){                   //Clear Buffer
       for (i = 0; i < Serial.available(); i++)
         rxBufferCheckCount = Serial.read();
       rxBufferCheckCount = 0;
+      timerStop(TIMER_CAT_RX);
+      catStatsTimeout();
     }
     else if (rxBufferCheckCount < Serial.available()){      // Increase buffer count, slow arrive
       rxBufferCheckCount = Serial.available();
-      rxBufferArriveTime = millis() + CAT_RECEIVE_TIMEOUT;  //Set time for timeout
+      timerStart(TIMER_CAT_RX, CAT_RECEIVE_TIMEOUT);        //Set time for timeout
     }
     return;
   }
@@ -425,11 +463,14 @@ void checkCAT(){
   //Arived CAT DATA
   for (i = 0; i < 5; i++)
     cat[i] = Serial.read();
+  trace(TRACE_CAT, cat[4], (cat[0] << 8) | cat[1]);
 
 
   //this code is not re-entrant.
-  if (insideCat == 1)
+  if (insideCat == 1) {
+    catStatsDropped();
     return;
+  }
   insideCat = 1;
 
 /**
@@ -450,6 +491,9 @@ void checkCAT(){
     displayText("CAT on", 100,120,100,40, ILI9341_ORANGE, ILI9341_BLACK, ILI9341_WHITE);
   }
 */
+  //a dialog that checks CAT while the command runs reads the next frame over cat[]
+  command = cat[4];
   processCATCommand2(cat);
+  catStatsDone(command);
   insideCat = 0;
 }
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include "ubitx.h"
+#include "trace.h"
 
 // *************  SI5315 routines - tks Jerry Gaffke, KE7ER   ***********************
 
@@ -54,19 +55,25 @@ void i2cWrite(uint8_t reg, uint8_t val) {   // write reg via i2c
   Wire.beginTransmission(SI5351BX_ADDR);
   Wire.write(reg);
   Wire.write(val);
-  Wire.endTransmission();
+  busBytes(3);                          // the address, the register and the value
+  byte status = Wire.endTransmission();
+  if (status)
+    trace(TRACE_I2C_ERROR, status, reg);
 }
 
 void i2cWriten(uint8_t reg, uint8_t *vals, uint8_t vcnt) {  // write array
   Wire.beginTransmission(SI5351BX_ADDR);
   Wire.write(reg);
+  busBytes(vcnt + 2);                   // the address, the register and the values
   while (vcnt--) Wire.write(*vals++);
-  Wire.endTransmission();
+  byte status = Wire.endTransmission();
+  if (status)
+    trace(TRACE_I2C_ERROR, status, reg);
 }
 
 
 void si5351bx_init() {                  // Call once at power-up, start PLLA
-  uint8_t reg;  uint32_t msxp1;
+  uint32_t msxp1;
   Wire.begin();
   i2cWrite(149, 0);                     // SpreadSpectrum off
   i2cWrite(3, si5351bx_clken);          // Disable all CLK output drivers
@@ -86,6 +93,7 @@ void si5351bx_init() {                  // Call once at power-up, start PLLA
 
 void si5351bx_setfreq(uint8_t clknum, uint32_t fout) {  // Set a CLK to fout Hz
   uint32_t  msa, msb, msc, msxp1, msxp2, msxp3p2top;
+  busEnter(BUS_SI5351);
   if ((fout < 500000) || (fout > 109000000)) // If clock freq out of range
     si5351bx_clken |= 1 << clknum;      //  shut down the clock
   else {
@@ -111,6 +119,7 @@ void si5351bx_setfreq(uint8_t clknum, uint32_t fout) {  // Set a CLK to fout Hz
     si5351bx_clken &= ~(1 << clknum);   // Clear bit to enable clock
   }
   i2cWrite(3, si5351bx_clken);        // Enable/disable clock
+  busLeave();
 }
 
 void si5351_set_calibration(int32_t cal){
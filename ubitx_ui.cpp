@@ -3,6 +3,9 @@
 #include "morse.h"
 #include "ubitx.h"
 #include "nano_gui.h"
+#include "fastio.h"
+#include "scratch.h"
+#include "trace.h"
 /* N8LOV Mods
    20210106 - Mod band selection.  Fix formatFreq to handle frequencies below 1000Khz.  Use defines for freq limits in enterFreq.  Make RIT not selectable during SPL.
    20210107 - Implemented tuning bounds in fastTune.
@@ -24,14 +27,15 @@
 
 #define BUTTON_SELECTED 1
 
+//the buttons and the band plan live in the flash with their labels inside them,
+//memcpy_P() brings one into the RAM, text and all, when it is needed
 struct Button {
   int x, y, w, h;
-  char *text;
+  char text[5];
   //char *morse;
 };
 
-#define MAX_BUTTONS 14
-const struct Button btn_set[MAX_BUTTONS] PROGMEM = {
+const struct Button btn_set[] PROGMEM = {
   //const struct Button  btn_set [] = {
   {VFOA_X, ROW1_Y, VFO_W, VFO_H, "VFOA"},
   {VFOB_X, ROW1_Y, VFO_W, VFO_H, "VFOB"},
@@ -39,26 +43,34 @@ const struct Button btn_set[MAX_BUTTONS] PROGMEM = {
   {COL1_X, ROW3_Y, BTN_W, BTN_H, "USB"},
   {COL2_X, ROW3_Y, BTN_W, BTN_H, "LSB"},
   {COL3_X, ROW3_Y, BTN_W, BTN_H, "CW"},
+#if FEATURE_UI_EXTRAS
   {COL4_X, ROW3_Y, BTN_W, BTN_H, "A>I"},// 'A>I' - copy active VFO freq to inactive VFO & set split mode for handling pileup/ if in RIT, RX freq to active, TX Freq to Inactive then RIT off
+#endif
   {COL5_X, ROW3_Y, BTN_W, BTN_H, "SPL"},
 
-/* -RIT  {COL1_X, ROW4_Y, BTN_W, BTN_H, "RIT"},
--RIT */
+#if FEATURE_RIT
+  {COL1_X, ROW4_Y, BTN_W, BTN_H, "RIT"},
+#endif
   //{COL1_X, ROW4_Y, BTN_W, BTN_H, ""},
   //{COL2_X, ROW4_Y, BTN_W, BTN_H, ""},
   {COL3_X, ROW4_Y, BTN_W, BTN_H, "FRQ"},
+#if FEATURE_BAND_SELECT
   {COL4_X, ROW4_Y, BTN_W, BTN_H, "BND"},
+#endif
+#if FEATURE_UI_EXTRAS
   {COL5_X, ROW4_Y, BTN_W, BTN_H, "1Kz"}, // '1Kz' - toggle to tune freq 1khz only in active VFO - to support split mode pileup 
 
   {COL1_X, ROW5_Y, BTN_W, BTN_H, "SAV"}, // save the active vfo to EEPROM
   {COL2_X, ROW5_Y, BTN_W, BTN_H, "RCL"}, // recall the active vfo from EEPROM
+#endif
   //{COL3_X, ROW5_Y, BTN_W, BTN_H, ""},
   {COL4_X, ROW5_Y, BTN_W, BTN_H, "WPM"},
   {COL5_X, ROW5_Y, BTN_W, BTN_H, "TON"},
 };
+//the count follows the buttons that the configuration leaves in
+#define MAX_BUTTONS (int)(sizeof(btn_set) / sizeof(struct Button))
 
-#define MAX_KEYS 15
-const struct Button keypad[MAX_KEYS] PROGMEM = {
+const struct Button keypad[] PROGMEM = {
   {COL1_X, ROW3_Y, BTN_W, BTN_H,  "1"}, //, "1"},
   {COL2_X, ROW3_Y, BTN_W, BTN_H, "2"}, //, "2"},
   {COL3_X, ROW3_Y, BTN_W, BTN_H, "3"}, //, "3"},
@@ -77,8 +89,9 @@ const struct Button keypad[MAX_KEYS] PROGMEM = {
   {COL4_X, ROW5_Y, BTN_W, BTN_H,  ""}, //, ""},
   {COL5_X, ROW5_Y, BTN_W, BTN_H,  "Can"}, //, "C"},
 };
+#define MAX_KEYS (int)(sizeof(keypad) / sizeof(struct Button))
 
-
+#if FEATURE_BAND_SELECT
 // N8LOV - Radio Band Frequency Data
 
 // bit value definitions for bitValue in struct
@@ -88,8 +101,8 @@ const struct Button keypad[MAX_KEYS] PROGMEM = {
 
 
 struct Freq {
-  char *text; // frequency display value, ?? chars max
-  unsigned long Hz; // Frequency in hz
+  char text[9]; // frequency display value, 8 chars max
+  uint32_t Hz; // Frequency in hz
   unsigned char bitValues; // bit oriented selections using defines above
 };
 
@@ -101,8 +114,7 @@ struct Freq {
 // Must be in order of lowest freq to highest.  Failure to order them this way could lead
 // to some misbehavior during selection.
 // Desired settings for USB/LSB and CW are bit or'ed together.
-#define MAX_FREQS 22
-const struct Freq freq_set[MAX_FREQS] PROGMEM = {
+const struct Freq freq_set[] PROGMEM = {
   // 2200M
   //{"2200 Min", 135700, bLSB},
   //{"Max", 137800, bLSB},
@@ -189,11 +201,14 @@ const struct Freq freq_set[MAX_FREQS] PROGMEM = {
   {"10 SSB2", 28385000, bUSB},
   //{"Max", 29700000, bUSB},
 };
+#define MAX_FREQS (int)(sizeof(freq_set) / sizeof(struct Freq))
+#endif
 
-boolean getButton(char *text, struct Button *b) {
+//the label to look for is in the flash, as in getButton(PSTR("SPL"), &b)
+boolean getButton(PGM_P text, struct Button *b) {
   for (int i = 0; i < MAX_BUTTONS; i++) {
     memcpy_P(b, btn_set + i, sizeof(struct Button));
-    if (!strcmp(text, b->text)) {
+    if (!strcmp_P(b->text, text)) {
       return true;
     }
   }
@@ -201,94 +216,202 @@ boolean getButton(char *text, struct Button *b) {
 }
 
 /*
-   This formats the frequency given in f
+   This formats the frequency given in f as kHz to two decimals, 8 characters wide: " 7285.00"
+   The digits come out of the BCD frequency one nibble at a time, from the 10 MHz down to the tens of Hz
 */
-void formatFreq(long f, char *buff) {
-  // tks Jack Purdum W8TEE
-  // replaced fsprint commmands by str commands for code size reduction
-
-  memset(buff, 0, 10);
-  memset(b, 0, sizeof(b));
-
-  ultoa(f, b, DEC);
-
-  // N8LOV - Handle frequencies <1000Khz.  Saves 24 bytes of program storage.
-  size_t n = strlen(b);
-  memset(buff, ' ', 8 - n);   // Start with one space for every digit fewer than 8 digits
-  strncat(buff, b, n - 3);    // Add the Khz digits
-  strcat(buff, ".");          // Add the decimal
-  strncat(buff, &b[n - 3], 2); // Add the hundreds and tens digits
+void formatFreq(int32_t f, char *buff) {
+  uint32_t bcd = bcdFrequency(f);
+  bool leading = true;
+
+  for (byte i = 0; i < 7; i++) {
+    byte digit = bcd >> 28;
+    bcd <<= 4;
+
+    if (i == 5)
+      *buff++ = '.';          // Add the decimal
+    // N8LOV - Handle frequencies <1000Khz. The leading zeros of the Khz digits are spaces
+    leading = leading && digit == 0 && i < 4;
+    *buff++ = leading ? ' ' : '0' + digit;
+  }
+  *buff = 0;
 }
 
+/**
+ * The text of the command bar is centred, only the middle of the bar is written. cmdbarInk is
+ * how wide that middle is, clearCommandbar() fills just it and drawCommandbar() draws the new
+ * text in a box as wide as it or the old text, whichever is wider. The widths are kept even so
+ * the text lands where it would in a box across the whole bar. Code that writes the bar
+ * some other way sets it to FULL_W.
+ */
+static int cmdbarInk = FULL_W;
+
 // N8LOV - add command bar clear function
 void clearCommandbar() {
-  displayFillrect(CMDBAR_X, ROW2_Y, FULL_W, BTN_H, DISPLAY_NAVY);
+  if (cmdbarInk)
+    displayFillrect(CMDBAR_X + (FULL_W - cmdbarInk) / 2, ROW2_Y, cmdbarInk, BTN_H, DISPLAY_NAVY);
+  cmdbarInk = 0;
+}
+
+//the box for a text this wide, the glyphs can reach a little past their advance on either side
+static int cmdbarBox(int extent) {
+  int ink = (extent + 9) & ~1;
+
+  if (ink > FULL_W)
+    ink = FULL_W;
+  int w = ink > cmdbarInk ? ink : cmdbarInk;
+  cmdbarInk = ink;
+  return w;
 }
 
 void drawCommandbar(char *text) {
-  clearCommandbar(); // N8LOV
-  //displayFillrect(CMDBAR_X,ROW2_Y,FULL_W, BTN_H, DISPLAY_NAVY);
-  displayText(text, CMDBAR_X, ROW2_Y, FULL_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY); // N8LOV
+  int w = cmdbarBox(displayTextExtent(text));
+  displayText(text, CMDBAR_X + (FULL_W - w) / 2, ROW2_Y, w, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY); // N8LOV
 }
 
-/** A generic control to read variable values
+void drawCommandbar(const __FlashStringHelper *text) {
+  int w = cmdbarBox(displayTextExtent(text));
+  displayText(text, CMDBAR_X + (FULL_W - w) / 2, ROW2_Y, w, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
+}
+
+/**
+   The dialog state machines, see ubitx.h
 */
-int getValueByKnob(int minimum, int maximum, int step_size,  int initial, char* prefix, char *postfix)
-{
-  int knob = 0;
-  int knob_value;
+DialogStep dialogStep = NULL;
+static bool dialogPaused = false;
+static unsigned int dialogPause;
+static bool dialogPacing = false;   //a press ends the pause, see dialogPace()
+static bool dialogPressed = false;  //the press that ended it, for dialogButton()
+static bool touchHeld = false;  //a touch that was on when the last dialog closed, checkTouch() ignores it
+
+void dialogOpen(DialogStep step) {
+  dialogStep = step;
+  dialogPressed = false;
+  menuOn = 1;
+}
 
-  while (btnDown())
-    active_delay(100);
+void dialogClose() {
+  dialogStep = NULL;
+  menuOn = 0;
+  touchHeld = true;
+}
 
-  active_delay(200);
-  knob_value = initial;
+void dialogSettle(unsigned int ms) {
+  dialogPause = ms;
+  dialogPaused = true;
+  dialogPacing = false;
+  dialogPressed = false;
+  timerStart(TIMER_DIALOG, ms);
+}
+
+void dialogPace(unsigned int ms) {
+  dialogSettle(ms);
+  //a button still down from before is waited out as by dialogSettle()
+  dialogPacing = !btnDown();
+}
+
+bool dialogButton() {
+  if (dialogPressed) {
+    dialogPressed = false;
+    return true;
+  }
+  return btnDown();
+}
 
-  strcpy(b, prefix);
-  itoa(knob_value, c, 10);
-  strcat(b, c);
-  strcat(b, postfix);
-  drawCommandbar(b);
-
-  while ((!btnDown() && !readTouch()) && digitalRead(PTT) == HIGH) { // N8LOV
-
-    knob = enc_read();
-    if (knob != 0) {
-      if (knob_value > minimum && knob < 0)
-        knob_value -= step_size;
-      if (knob_value < maximum && knob > 0)
-        knob_value += step_size;
-
-      strcpy(b, prefix);
-      itoa(knob_value, c, 10);
-      strcat(b, c);
-      strcat(b, postfix);
-      drawCommandbar(b);
+bool dialogSettled() {
+  if (!dialogPaused)
+    return true;
+
+  //the time is counted from when the button comes up, unless a new press cuts the pace short
+  if (btnDown()) {
+    if (!dialogPacing) {
+      timerStart(TIMER_DIALOG, dialogPause);
+      return false;
     }
-    checkCAT();
+    dialogPressed = true;
   }
-  clearCommandbar(); // N8LOV
-  //displayFillrect(30,41,280, 32, DISPLAY_NAVY);
-  return knob_value;
+  else if (!timerExpired(TIMER_DIALOG))
+    return false;
+
+  timerStop(TIMER_DIALOG);
+  dialogPaused = false;
+  return true;
 }
 
-void printCarrierFreq(unsigned long freq) {
+/** A generic control to read variable values
+*/
+static int knob_value, knob_minimum, knob_maximum, knob_step;
+static PGM_P knob_prefix, knob_postfix;
+static void (*knob_done)(int value);
+
+static void drawKnobValue() {
+  Scratch<24> text;
+  Scratch<7> number;
+
+  strcpy_P(text, knob_prefix);
+  itoa(knob_value, number, 10);
+  strcat(text, number);
+  strcat_P(text, knob_postfix);
+  drawCommandbar(text);
+}
 
-  memset(c, 0, sizeof(c));
-  memset(b, 0, sizeof(b));
+static void getValueByKnobStep() {
+  int knob;
 
-  ultoa(freq, b, DEC);
+  if (!dialogSettled())
+    return;
 
-  strncat(c, b, 2);
-  strcat(c, ".");
-  strncat(c, &b[2], 3);
-  strcat(c, ".");
-  strncat(c, &b[5], 1);
-  displayText(c, 110, 100, 100, 30, DISPLAY_CYAN, DISPLAY_NAVY, DISPLAY_NAVY);
+  if (btnDown() || readTouch() || FastPin<PTT>::read() == LOW) { // N8LOV
+    clearCommandbar(); // N8LOV
+    //displayFillrect(30,41,280, 32, DISPLAY_NAVY);
+    dialogClose();
+    dialogSettle(500);
+    knob_done(knob_value);
+    return;
+  }
+
+  knob = enc_read();
+  if (knob != 0) {
+    if (knob_value > knob_minimum && knob < 0)
+      knob_value -= knob_step;
+    if (knob_value < knob_maximum && knob > 0)
+      knob_value += knob_step;
+    drawKnobValue();
+  }
 }
 
-void displayDialog(char *title, char *instructions) {
+void getValueByKnob(int minimum, int maximum, int step_size,  int initial, PGM_P prefix, PGM_P postfix, void (*done)(int value))
+{
+  knob_minimum = minimum;
+  knob_maximum = maximum;
+  knob_step = step_size;
+  knob_value = initial;
+  knob_prefix = prefix;
+  knob_postfix = postfix;
+  knob_done = done;
+
+  drawKnobValue();
+  dialogOpen(getValueByKnobStep);
+  dialogSettle(200);
+}
+
+void printCarrierFreq(uint32_t freq) {
+  Scratch<11> digits;
+  Scratch<12> text;
+
+  ultoa(freq, digits, DEC);
+
+  memcpy(text, digits, 2);
+  text[2] = 0;
+  strcat_P(text, PSTR("."));
+  strncat(text, digits + 2, 3);
+  strcat_P(text, PSTR("."));
+  strncat(text, digits + 5, 1);
+  displayText(text, 110, 100, 100, 30, DISPLAY_CYAN, DISPLAY_NAVY, DISPLAY_NAVY);
+}
+
+void displayDialog(const __FlashStringHelper *title, const __FlashStringHelper *instructions) {
   displayClear(DISPLAY_BLACK);
+  guiDirty(0, 0, FULL_W, FULL_H);
   displayRect(10, 10, 300, 220, DISPLAY_WHITE);
   displayHline(20, 45, 280, DISPLAY_WHITE);
   displayRect(12, 12, 296, 216, DISPLAY_WHITE);
@@ -299,56 +422,55 @@ void displayDialog(char *title, char *instructions) {
 
 
 
-char vfoDisplay[12];
+//what each vfo shows, so that only the digits that change are drawn again. Empty draws it all
+char vfoDisplay[2][12];
 void displayVFO(int vfo) {
   int x, y;
-  int displayColor, displayBorder;
+  int displayColor = DISPLAY_GREEN;
   Button b;
+  char *shown = vfoDisplay[vfo == VFO_B];
+  Scratch<sizeof(vfoDisplay[0])> text;
 
   if (vfo == VFO_A) {
-    getButton("VFOA", &b);
+    getButton(PSTR("VFOA"), &b);
     if (splitOn) {
       if (vfoActive == VFO_A)
-        strcpy(c, "R:");
+        strcpy_P(text, PSTR("R:"));
       else
-        strcpy(c, "T:");
+        strcpy_P(text, PSTR("T:"));
     }
     else
-      strcpy(c, "A:");
+      strcpy_P(text, PSTR("A:"));
     if (vfoActive == VFO_A) {
-      formatFreq(frequency, c + 2);
+      formatFreq(frequency, text + 2);
       displayColor = DISPLAY_WHITE;
-      displayBorder = DISPLAY_BLACK;
     } else {
-      formatFreq(vfoA, c + 2);
+      formatFreq(vfoA, text + 2);
       displayColor = DISPLAY_GREEN;
-      displayBorder = DISPLAY_BLACK;
     }
   }
 
   if (vfo == VFO_B) {
-    getButton("VFOB", &b);
+    getButton(PSTR("VFOB"), &b);
 
     if (splitOn) {
       if (vfoActive == VFO_B)
-        strcpy(c, "R:");
+        strcpy_P(text, PSTR("R:"));
       else
-        strcpy(c, "T:");
+        strcpy_P(text, PSTR("T:"));
     }
     else
-      strcpy(c, "B:");
+      strcpy_P(text, PSTR("B:"));
     if (vfoActive == VFO_B) {
-      formatFreq(frequency, c + 2);
+      formatFreq(frequency, text + 2);
       displayColor = DISPLAY_WHITE;
-      displayBorder = DISPLAY_WHITE;
     } else {
       displayColor = DISPLAY_GREEN;
-      displayBorder = DISPLAY_BLACK;
-      formatFreq(vfoB, c + 2);
+      formatFreq(vfoB, text + 2);
     }
   }
 
-  if (vfoDisplay[0] == 0) {
+  if (shown[0] == 0) {
     displayFillrect(b.x, b.y, b.w, b.h, DISPLAY_BLACK);
     if (vfoActive == vfo)
       displayRect(b.x, b.y, b.w , b.h, DISPLAY_WHITE);
@@ -358,203 +480,258 @@ void displayVFO(int vfo) {
   x = b.x + 6;
   y = b.y + 3;
 
-  char *text = c;
-
-  for (int i = 0; i <= strlen(c); i++) {
-    char digit = c[i];
-    if (digit != vfoDisplay[i]) {
+  bool spill = false;   //what was drawn last reached into this character's cell
+  for (unsigned i = 0; i <= strlen(text); i++) {
+    char digit = text[i];
+    if (digit != shown[i] || spill) {
 
       displayFillrect(x, y, 15, b.h - 6, DISPLAY_BLACK);
       //checkCAT();
 
       displayChar(x, y + TEXT_LINE_HEIGHT + 3, digit, displayColor, DISPLAY_BLACK);
       checkCAT();
+      //the letter of the label is wider than its cell, the fill of a ':' or a '.' wider than theirs
+      spill = i == 0 || digit == ':' || digit == '.';
     }
+    else
+      spill = false;
     if (digit == ':' || digit == '.')
       x += 7;
     else
       x += 16;
-    text++;
   }//end of the while loop of the characters to be printed
 
-  strcpy(vfoDisplay, c);
+  strcpy(shown, text);
+}
+
+//draws the vfo again from scratch, the box and all the digits
+static void vfoRepaint(int vfo) {
+  memset(vfoDisplay[vfo == VFO_B], 0, sizeof(vfoDisplay[0]));
+  displayVFO(vfo);
 }
 
+//true for a button that shows a setting that is on, it is drawn highlighted
+static bool btnIsOn(struct Button *b) {
+  return
+#if FEATURE_RIT
+         (!strcmp_P(b->text, PSTR("RIT")) && ritOn) ||
+#endif
+         (!strcmp_P(b->text, PSTR("USB")) && isUSB) ||
+         (!strcmp_P(b->text, PSTR("LSB")) && !isUSB) ||
+         (!strcmp_P(b->text, PSTR("CW")) && cwMode) ||
+         (!strcmp_P(b->text, PSTR("1Kz")) && oneKhzOn) ||
+         (!strcmp_P(b->text, PSTR("BND")) && bandSelectOn) ||
+         (!strcmp_P(b->text, PSTR("SPL")) && splitOn);
+}
 
 void btnDraw(struct Button *b) {
-  if (!strcmp(b->text, "VFOA")) {
-    memset(vfoDisplay, 0, sizeof(vfoDisplay));
-    displayVFO(VFO_A);
-  }
-  else if (!strcmp(b->text, "VFOB")) {
-    memset(vfoDisplay, 0, sizeof(vfoDisplay));
-    displayVFO(VFO_B);
-  }
-  else if (
-/* -RIT    (!strcmp(b->text, "RIT") && ritOn) ||
--RIT */
-          
-           (!strcmp(b->text, "USB") && isUSB) ||
-           (!strcmp(b->text, "LSB") && !isUSB) ||
-           (!strcmp(b->text, "1Kz") && oneKhzOn) ||
-           (!strcmp(b->text, "BND") && bandSelectOn) ||
-           (!strcmp(b->text, "SPL") && splitOn))
-    displayText(b->text, b->x, b->y, b->w, b->h, DISPLAY_BLACK, DISPLAY_ORANGE, DISPLAY_DARKGREY);
-  else if (!strcmp(b->text, "CW") && cwMode)
+  if (!strcmp_P(b->text, PSTR("VFOA")))
+    vfoRepaint(VFO_A);
+  else if (!strcmp_P(b->text, PSTR("VFOB")))
+    vfoRepaint(VFO_B);
+  else if (btnIsOn(b))
     displayText(b->text, b->x, b->y, b->w, b->h, DISPLAY_BLACK, DISPLAY_ORANGE, DISPLAY_DARKGREY);
   else
     displayText(b->text, b->x, b->y, b->w, b->h, DISPLAY_GREEN, DISPLAY_BLACK, DISPLAY_DARKGREY);
 }
 
-/* -RIT
+/**
+ * The main screen remembers how it last drew each button of btn_set, one bit each, and
+ * guiRefresh() draws again only those whose setting has changed since. The code that changes
+ * a setting calls it instead of drawing the buttons it might have touched, and CAT calls it too.
+ * Over an open dialog, or while guiPaintStep() is still painting the screen, nothing is drawn:
+ * the refresh is left for guiPaintStep() to do once the main screen is back.
+ */
+static_assert(MAX_BUTTONS <= 16, "one bit for each button");
+static unsigned int btnShown = 0;   //drawn since the screen was cleared
+static unsigned int btnLit = 0;     //drawn highlighted
+static bool guiStale = false;
+
+/**
+ * What a dialog drew over, as one rectangle that grows to take in each guiDirty(). The next
+ * guiRefresh() paints the main screen back into it and nowhere else: the buttons and the
+ * status bar that reach into it are drawn again, and only the background between them is
+ * filled. A dialog marks its area as it draws, and calls guiRefresh() once it has closed.
+ */
+static int dirtyX1, dirtyY1, dirtyX2, dirtyY2;    //empty when dirtyX2 <= dirtyX1
+
+//draws the button i of btn_set and remembers how
+static void btnPaint(int i, struct Button *b) {
+  unsigned int bit = 1 << i;
+
+  btnDraw(b);
+  btnShown |= bit;
+  if (btnIsOn(b))
+    btnLit |= bit;
+  else
+    btnLit &= ~bit;
+}
+
+#if FEATURE_RIT
 void displayRIT() {
+  Scratch<13> text;
+
   clearCommandbar(); // N8LOV
   //displayFillrect(0,41,320,30, DISPLAY_NAVY);
   if (ritOn) {
-    strcpy(c, "TX:");
-    formatFreq(ritTxFrequency, c + 3);
+    strcpy_P(text, PSTR("TX:"));
+    formatFreq(ritTxFrequency, text + 3);
     if (vfoActive == VFO_A)
-      displayText(c, VFOA_X, ROW2_Y, VFO_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
+      displayText(text, VFOA_X, ROW2_Y, VFO_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
     else
-      displayText(c, VFOB_X, ROW2_Y, VFO_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
+      displayText(text, VFOB_X, ROW2_Y, VFO_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
   }
   else {
     if (vfoActive == VFO_A)
-      displayText("", VFOA_X, ROW2_Y, VFO_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
+      displayText(F(""), VFOA_X, ROW2_Y, VFO_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
     else
-      displayText("", VFOB_X, ROW2_Y, VFO_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
+      displayText(F(""), VFOB_X, ROW2_Y, VFO_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
   }
+  cmdbarInk = FULL_W;
 }
--RIT */
+#endif
 
-void fastTune() {
+static void fastTuneStep() {
   int encoder;
 
-  //if the btn is down, wait until it is up
-  while (btnDown())
-    active_delay(50);
-  active_delay(300);
-  
+  if (!dialogSettled())
+    return;
+
+  //exit, the button is debounced by the settle
+  if (btnDown()) {
+    clearCommandbar(); // N8LOV
+    //displayFillrect(100, 55, 120, 30, DISPLAY_NAVY);
+    dialogClose();
+    dialogSettle(300);
+    return;
+  }
+
+  encoder = enc_read();
+  if (encoder != 0) {
+
+    frequency += (encoder > 0 ? 50000l : -50000l);
+
+    // N8LOV - observe defined frequency bounds
+    if (frequency > HIGHEST_FREQ) frequency = HIGHEST_FREQ;
+    if (frequency < LOWEST_FREQ) frequency = LOWEST_FREQ;
+
+    setFrequency(frequency);
+    displayVFO(vfoActive);
+  }
+}
+
+void fastTune() {
   if (bandSelectOn) toggleBandSelect(); // N8LOV - turn off band select in fasttune mode
   clearCommandbar();
   
-  displayText("Fast tune", 145, ROW2_Y, 30, BTN_H, DISPLAY_CYAN, DISPLAY_NAVY, DISPLAY_NAVY); // N8LOV
-  while (1) {
-    checkCAT();
-
-    //exit after debouncing the btnDown
-    if (btnDown()) {
-      clearCommandbar(); // N8LOV
-      //displayFillrect(100, 55, 120, 30, DISPLAY_NAVY);
-
-      //wait until the button is realsed and then return
-      while (btnDown())
-        active_delay(50);
-      active_delay(300);
-      return;
-    }
+  displayText(F("Fast tune"), 145, ROW2_Y, 30, BTN_H, DISPLAY_CYAN, DISPLAY_NAVY, DISPLAY_NAVY); // N8LOV
+  cmdbarInk = FULL_W;
 
-    encoder = enc_read();
-    if (encoder != 0) {
+  //if the btn is down, wait until it is up
+  dialogOpen(fastTuneStep);
+  dialogSettle(300);
+}
 
-      frequency += (encoder > 0 ? 50000l : -50000l);
+//the keypad keeps its own digits while it is up
+static char keypadEntry[9];
+static byte cursor_pos;
+static bool keypadTouched;
 
-      // N8LOV - observe defined frequency bounds
-      if (frequency > HIGHEST_FREQ) frequency = HIGHEST_FREQ;
-      if (frequency < LOWEST_FREQ) frequency = LOWEST_FREQ;
+static void enterFreqStep() {
+  if (!dialogSettled())
+    return;
 
-      setFrequency(frequency);
-      displayVFO(vfoActive);
-    }
-  }// end of the event loop
-}
+  //act once on each touch, as the finger comes down
+  if (!readTouch()) {
+    keypadTouched = false;
+    return;
+  }
+  if (keypadTouched)
+    return;
+  keypadTouched = true;
 
-void enterFreq() {
-  //force the display to refresh everything
-  //display all the buttons
-  int f;
+  scaleTouch(&ts_point);
 
   for (int i = 0; i < MAX_KEYS; i++) {
     struct Button b;
     memcpy_P(&b, keypad + i, sizeof(struct Button));
-    btnDraw(&b);
-  }
 
-  int cursor_pos = 0;
-  memset(c, 0, sizeof(c));
-  f = frequency / 1000l;
-
-  while (1) {
-
-    checkCAT();
-    if (!readTouch())
-      continue;
+    int x2 = b.x + b.w;
+    int y2 = b.y + b.h;
 
-    scaleTouch(&ts_point);
-
-    int total = sizeof(btn_set) / sizeof(struct Button);
-    for (int i = 0; i < MAX_KEYS; i++) {
-      struct Button b;
-      memcpy_P(&b, keypad + i, sizeof(struct Button));
-
-      int x2 = b.x + b.w;
-      int y2 = b.y + b.h;
-
-      if (b.x < ts_point.x && ts_point.x < x2 &&
-          b.y < ts_point.y && ts_point.y < y2) {
-        if (!strcmp(b.text, "OK")) {
-          long f = atol(c);
-          // N8LOV - use defines for limits
-          if (HIGHEST_FREQ / 1000l >= f && f > LOWEST_FREQ / 1000l) {
-            frequency = f * 1000l;
-            setFrequency(frequency);
-            if (vfoActive == VFO_A)
-              vfoA = frequency;
-            else
-              vfoB = frequency;
-            //saveVFOs();  // N8LOV - reduce EEPROM writes
-          }
-          guiUpdate();
-          return;
-        }
-        else if (!strcmp(b.text, "<-")) {
-          c[cursor_pos] = 0;
-          if (cursor_pos > 0)
-            cursor_pos--;
-          c[cursor_pos] = 0;
-        }
-        else if (!strcmp(b.text, "Can")) {
-          guiUpdate();
-          ts_point.x=-1; // N8LOV - untouch button location
-          return;
-        }
-        else if ('0' <= b.text[0] && b.text[0] <= '9') {
-          c[cursor_pos++] = b.text[0];
-          c[cursor_pos] = 0;
+    if (b.x < ts_point.x && ts_point.x < x2 &&
+        b.y < ts_point.y && ts_point.y < y2) {
+      if (!strcmp_P(b.text, PSTR("OK"))) {
+        int32_t f = atol(keypadEntry);
+        // N8LOV - use defines for limits
+        if (HIGHEST_FREQ / 1000l >= f && f > LOWEST_FREQ / 1000l) {
+          frequency = f * 1000l;
+          setFrequency(frequency);
+          if (vfoActive == VFO_A)
+            vfoA = frequency;
+          else
+            vfoB = frequency;
+          //saveVFOs();  // N8LOV - reduce EEPROM writes
         }
+        dialogClose();
+        guiRefresh();
+        return;
       }
-    } // end of the button scanning loop
-    strcpy(b, c);
-    strcat(b, " KHz");
-    displayText(b, COL1_X, ROW2_Y, FULL_W, BTN_H, DISPLAY_WHITE, DISPLAY_NAVY, DISPLAY_NAVY);
-    delay(300);
-    while (readTouch())
-      checkCAT();
-  } // end of event loop : while(1)
+      else if (!strcmp_P(b.text, PSTR("<-"))) {
+        keypadEntry[cursor_pos] = 0;
+        if (cursor_pos > 0)
+          cursor_pos--;
+        keypadEntry[cursor_pos] = 0;
+      }
+      else if (!strcmp_P(b.text, PSTR("Can"))) {
+        dialogClose();
+        guiRefresh();
+        return;
+      }
+      else if ('0' <= b.text[0] && b.text[0] <= '9' && cursor_pos < sizeof(keypadEntry) - 1) {
+        keypadEntry[cursor_pos++] = b.text[0];
+        keypadEntry[cursor_pos] = 0;
+      }
+    }
+  } // end of the button scanning loop
+  Scratch<16> text;
+  strcpy(text, keypadEntry);
+  strcat_P(text, PSTR(" KHz"));
+  drawCommandbar(text);
+  dialogSettle(300);
+}
 
+void enterFreq() {
+  //the keys over the buttons, and the digits in the command bar. The main screen comes back there
+  guiDirty(COL1_X, ROW2_Y, FULL_W, BTN_H);
+  for (int i = 0; i < MAX_KEYS; i++) {
+    struct Button b;
+    memcpy_P(&b, keypad + i, sizeof(struct Button));
+    btnDraw(&b);
+    guiDirty(b.x, b.y, b.w, b.h);
+  }
+
+  cursor_pos = 0;
+  memset(keypadEntry, 0, sizeof(keypadEntry));
+  keypadTouched = false;
+  dialogOpen(enterFreqStep);
 }
 
 void drawCWStatus() {
-  displayFillrect(COL1_X, ROW6_Y, FULL_W, BTN_H, DISPLAY_NAVY);
-  strcpy(b, " cw:");
+  Scratch<24> text;
+  Scratch<7> number;
+
+  //the text's box fills its part of the bar, the rest is filled here
+  displayFillrect(COL1_X + 210, ROW6_Y, FULL_W - 210, BTN_H, DISPLAY_NAVY);
+  strcpy_P(text, PSTR(" cw:"));
   int wpm = 1200 / cwSpeed;
-  itoa(wpm, c, 10);
-  strcat(b, c);
-  strcat(b, "wpm, ");
-  itoa(sideTone, c, 10);
-  strcat(b, c);
-  strcat(b, "hz");
-  displayText(b, COL1_X, ROW6_Y, 210, BTN_H, DISPLAY_CYAN, DISPLAY_NAVY, DISPLAY_NAVY);
+  itoa(wpm, number, 10);
+  strcat(text, number);
+  strcat_P(text, PSTR("wpm, "));
+  itoa(sideTone, number, 10);
+  strcat(text, number);
+  strcat_P(text, PSTR("hz"));
+  displayText(text, COL1_X, ROW6_Y, 210, BTN_H, DISPLAY_CYAN, DISPLAY_NAVY, DISPLAY_NAVY);
 }
 
 
@@ -568,7 +745,7 @@ void drawTx() {
   Button b;
   unsigned int c = (inTx ? DISPLAY_RED : ((TxVfo == vfoActive) ? DISPLAY_WHITE : DISPLAY_NAVY));
 
-  getButton( ((TxVfo == VFO_A) ? "VFOA" : "VFOB"), &b);
+  getButton((TxVfo == VFO_A) ? PSTR("VFOA") : PSTR("VFOB"), &b);
 
   displayRect(b.x, b.y, b.w , b.h, c);
 
@@ -580,33 +757,178 @@ void drawStatusbar() {
 }
 
 
-void guiUpdate() {
+//the next part of the screen guiPaintStep() will draw: a button, or the status bar after the last one
+//-1 when the screen is complete
+static int guiPart = -1;
+
+void guiPaintVFOs() {
 
   // use the current frequency as the VFO frequency for the active VFO
   displayClear(DISPLAY_NAVY);
+  btnShown = 0;
+  dirtyX2 = dirtyX1;
 
-  memset(vfoDisplay, 0, 12);
-  displayVFO(VFO_A);
+  vfoRepaint(VFO_A);
   checkCAT();
-  memset(vfoDisplay, 0, 12);
-  displayVFO(VFO_B);
+  vfoRepaint(VFO_B);
 
   checkCAT();
-/* -RIT
+#if FEATURE_RIT
   displayRIT();
   checkCAT();
--RIT */
+#endif
+
+  guiPart = 0;
+}
+
+bool guiPaintStep() {
+  if (guiPart < 0) {
+    if (guiStale)
+      guiRefresh();
+    return false;
+  }
+
+  if (guiPart < MAX_BUTTONS) {
+    struct Button b;
+    memcpy_P(&b, btn_set + guiPart, sizeof(struct Button));
+    btnPaint(guiPart, &b);
+    guiPart++;
+  }
+  else {
+    drawStatusbar();
+    guiPart = -1;
+  }
+  checkCAT();
+  return guiPart < 0;
+}
+
+void guiUpdate() {
+  guiPaintVFOs();
 
   //force the display to refresh everything
   //display all the buttons
+  while (!guiPaintStep())
+    ;
+}
+
+void guiDirty(int x, int y, int w, int h) {
+  if (dirtyX2 <= dirtyX1) {
+    dirtyX1 = x;
+    dirtyY1 = y;
+    dirtyX2 = x + w;
+    dirtyY2 = y + h;
+    return;
+  }
+  if (x < dirtyX1)
+    dirtyX1 = x;
+  if (y < dirtyY1)
+    dirtyY1 = y;
+  if (x + w > dirtyX2)
+    dirtyX2 = x + w;
+  if (y + h > dirtyY2)
+    dirtyY2 = y + h;
+}
+
+//the boxes that cover the main screen: the buttons of btn_set, and after them the status bar
+#define GUI_BOXES (MAX_BUTTONS + 1)
+
+static void guiBox(int i, struct Button *b) {
+  if (i < MAX_BUTTONS)
+    memcpy_P(b, btn_set + i, sizeof(struct Button));
+  else {
+    b->x = COL1_X;
+    b->y = ROW6_Y;
+    b->w = FULL_W;
+    b->h = BTN_H;
+  }
+}
+
+static bool guiBoxDirty(struct Button *b) {
+  return b->x < dirtyX2 && dirtyX1 < b->x + b->w && b->y < dirtyY2 && dirtyY1 < b->y + b->h;
+}
+
+//fills the background of the dirty rectangle a strip at a time, around the boxes that cross each strip
+static void guiFillDirty() {
+  struct Button b;
+
+  for (int y = dirtyY1; y < dirtyY2; ) {
+    //the strip goes down to the next top or bottom edge of a box
+    int y2 = dirtyY2;
+    for (int i = 0; i < GUI_BOXES; i++) {
+      guiBox(i, &b);
+      if (y < b.y && b.y < y2)
+        y2 = b.y;
+      if (y < b.y + b.h && b.y + b.h < y2)
+        y2 = b.y + b.h;
+    }
+
+    for (int x = dirtyX1; x < dirtyX2; ) {
+      //past the box x is in, or up to the next one that crosses the strip
+      int x2 = dirtyX2;
+      bool covered = false;
+      for (int i = 0; i < GUI_BOXES; i++) {
+        guiBox(i, &b);
+        if (b.y > y || b.y + b.h < y2)
+          continue;
+        if (b.x <= x && x < b.x + b.w) {
+          x2 = b.x + b.w;
+          covered = true;
+          break;
+        }
+        if (x < b.x && b.x < x2)
+          x2 = b.x;
+      }
+      if (!covered)
+        displayFillrect(x, y, x2 - x, y2 - y, DISPLAY_NAVY);
+      x = x2;
+    }
+    y = y2;
+  }
+}
+
+void guiRefresh() {
+  if (dialogStep || guiPart >= 0) {
+    guiStale = true;
+    return;
+  }
+  guiStale = false;
+
+  bool dirty = dirtyX2 > dirtyX1;
+  struct Button b;
+  if (dirty) {
+    guiFillDirty();
+    for (int i = 0; i < MAX_BUTTONS; i++) {
+      guiBox(i, &b);
+      if (guiBoxDirty(&b))
+        btnShown &= ~(1 << i);
+    }
+  }
+
   for (int i = 0; i < MAX_BUTTONS; i++) {
-    struct Button b;
+    unsigned int bit = 1 << i;
     memcpy_P(&b, btn_set + i, sizeof(struct Button));
-    btnDraw(&b);
-    checkCAT();
+
+    //the vfos keep track of their own digits, unless a dialog drew over them
+    if (!strncmp_P(b.text, PSTR("VFO"), 3) && (btnShown & bit))
+      continue;
+    if (!(btnShown & bit) || !(btnLit & bit) != !btnIsOn(&b)) {
+      btnPaint(i, &b);
+      checkCAT();
+    }
+  }
+  displayVFO(VFO_A);
+  displayVFO(VFO_B);
+
+  if (dirty) {
+    guiBox(MAX_BUTTONS, &b);
+    if (guiBoxDirty(&b))
+      drawStatusbar();
+#if FEATURE_RIT
+    if (ritOn && dirtyY1 < ROW2_Y + BTN_H && ROW2_Y < dirtyY2)
+      displayRIT();
+#endif
+    dirtyX2 = dirtyX1;
   }
-  drawStatusbar();
-  checkCAT();
 }
 
 
@@ -618,64 +940,55 @@ void updateDisplay() {
 
 
 
-/* -RIT
+#if FEATURE_RIT
 void ritToggle(struct Button *b) {
   // N8LOV - make RIT not selectable during SPL, since SPL selection disables RIT
   if (!ritOn && !splitOn)
     ritEnable(frequency);
   else
     ritDisable();
-  btnDraw(b);
+  guiRefresh();
   displayRIT();
 }
--RIT */
+#endif
 
+#if FEATURE_UI_EXTRAS
 // N8LOV 
 void oneKhzToggle(struct Button *b) {
   oneKhzOn = !oneKhzOn;
-  btnDraw(b);
+  guiRefresh();
 }
+#endif
 
 
 void splitToggle(struct Button *b) {
   if (bandSelectOn) toggleBandSelect();
   splitOn = !splitOn; // N8LOV
 
-  btnDraw(b);
-
-/* -RIT
+#if FEATURE_RIT
   //disable rit as well
   ritDisable();
-
-  struct Button b2;
-  getButton("RIT", &b2);
-  btnDraw(&b2);
-
-
   displayRIT();
--RIT */
-  memset(vfoDisplay, 0, sizeof(vfoDisplay));
-  displayVFO(VFO_A);
-  memset(vfoDisplay, 0, sizeof(vfoDisplay));
-  displayVFO(VFO_B);
+#endif
+  //the SPL and RIT buttons, and the R: and T: of the vfos
+  guiRefresh();
 }
 
+#if FEATURE_UI_EXTRAS
 // N8LOV - copy active VFO freq/modes to inactive VFO and set split mode operation
 void Act2Inact(struct Button *b) {
       displayText(b->text, b->x, b->y, b->w, b->h, DISPLAY_BLACK, DISPLAY_ORANGE, DISPLAY_DARKGREY);
       if (bandSelectOn) toggleBandSelect();
       struct Button b2;
       if (!splitOn) {
-         getButton("SPL", &b2);
+         getButton(PSTR("SPL"), &b2);
          splitToggle(&b2);
-/* -RIT
+#if FEATURE_RIT
       } else {
          //disable rit as well
          ritDisable();
-         getButton("RIT", &b2);
-         btnDraw(&b2);
          displayRIT();
--RIT */
+#endif
       }
  
       if (vfoActive == VFO_A) {
@@ -693,10 +1006,7 @@ void Act2Inact(struct Button *b) {
         vfoBcwMode = cwMode;
         vfoAcwMode = vfoBcwMode;
       }
-      memset(vfoDisplay, 0, sizeof(vfoDisplay));
-      displayVFO(VFO_A);
-      memset(vfoDisplay, 0, sizeof(vfoDisplay));
-      displayVFO(VFO_B);
+      guiRefresh();
       displayText(b->text, b->x, b->y, b->w, b->h, DISPLAY_GREEN, DISPLAY_BLACK, DISPLAY_DARKGREY);
 }   
 
@@ -716,36 +1026,25 @@ void  recallActiveVFO(struct Button *b){
   else 
     displayVFO(VFO_B);
   displayText(b->text, b->x, b->y, b->w, b->h, DISPLAY_GREEN, DISPLAY_BLACK, DISPLAY_DARKGREY);
-
-  struct Button b2;
-  getButton("USB", &b2);
-  btnDraw(&b2);
-  getButton("LSB", &b2);
-  btnDraw(&b2);
-  getButton("CW", &b2);
-  btnDraw(&b2);
+  guiRefresh();
 
   setFrequency(frequency);
 }
+#endif
 
 
 void cwToggle(struct Button *b) {
   cwMode = !cwMode; // N8LOV
   setFrequency(frequency);
-  btnDraw(b);
+  guiRefresh();
 }
 
 void sidebandToggle(struct Button *b) {
-  if (!strcmp(b->text, "LSB"))
+  if (!strcmp_P(b->text, PSTR("LSB")))
     isUSB = false;
   else
     isUSB = true;
-
-  struct Button e;
-  getButton("USB", &e);
-  btnDraw(&e);
-  getButton("LSB", &e);
-  btnDraw(&e);
+  guiRefresh();
 
     // N8LOV 
   if (vfoActive == VFO_A) 
@@ -758,34 +1057,25 @@ void sidebandToggle(struct Button *b) {
 
 
 void redrawVFOs() {
-
-  struct Button b;
-/* -RIT
+#if FEATURE_RIT
   ritDisable();
-  getButton("RIT", &b);
-  btnDraw(&b);
   displayRIT();
--RIT */
-  memset(vfoDisplay, 0, sizeof(vfoDisplay));
-  displayVFO(VFO_A);
-  memset(vfoDisplay, 0, sizeof(vfoDisplay));
-  displayVFO(VFO_B);
+#endif
+  //the active vfo has moved, its colours and box with it
+  vfoRepaint(VFO_A);
+  vfoRepaint(VFO_B);
 
-  //draw the lsb/usb buttons, the sidebands might have changed
-  getButton("LSB", &b);
-  btnDraw(&b);
-  getButton("USB", &b);
-  btnDraw(&b);
-  getButton("CW", &b); // N8LOV - Supports CW setting for each VFO
-  btnDraw(&b);
+  //the sideband and cw buttons, they might have changed with the vfo
+  guiRefresh();
 }
 
+#if FEATURE_BAND_SELECT
 static int enccnt = 0;
 
 // N8LOV - Sets the frequency/USB/LSB/CW info into the active vfo when selecting band
 // dir is the encoder value.
 // dir < 0 (counter clock-wise), go lower in freq, else go higher in freq.
-void setBandFreq(unsigned long f, int dir) {
+void setBandFreq(uint32_t f, int dir) {
   // Make encoder knob less sensitive so greater travel is needed to switch bands
   enccnt += dir;
   if (abs(enccnt) < 4) return; else enccnt = 0;
@@ -817,7 +1107,6 @@ void setBandFreq(unsigned long f, int dir) {
   // get the band data to apply
   memcpy_P(&fr, freq_set + li, sizeof(struct Freq));
   
-  struct Button e;
   // get the cwMode to set
   if (fr.bitValues & bCW)
     cwMode = true;
@@ -828,18 +1117,13 @@ void setBandFreq(unsigned long f, int dir) {
   frequency = fr.Hz;
 
   // get the sideband data to set
-  if (fr.bitValues & bUSB || (!fr.bitValues & bUSB && !fr.bitValues & bLSB))
+  if (fr.bitValues & bUSB || (!(fr.bitValues & bUSB) && !(fr.bitValues & bLSB)))
     isUSB = true;
   else
     isUSB = false;
 
   // update the buttons on the screen
-  getButton("CW", &e);
-  btnDraw(&e);
-  getButton("USB", &e);
-  btnDraw(&e);
-  getButton("LSB", &e);
-  btnDraw(&e);
+  guiRefresh();
 
   // display the band text on screen
   drawCommandbar(fr.text);
@@ -855,17 +1139,13 @@ void toggleBandSelect(){
   // Disable Split
   if (!bandSelectOn && splitOn) {
     struct Button b2;
-    getButton("SPL", &b2);
+    getButton(PSTR("SPL"), &b2);
     splitToggle(&b2);
   }
 
   bandSelectOn = !bandSelectOn;
 
-  struct Freq fr;
-  struct Button bttn;
-  getButton("BND", &bttn);
-
-  btnDraw(&bttn);
+  guiRefresh();
   
   if (bandSelectOn) {
 
@@ -882,140 +1162,154 @@ void toggleBandSelect(){
 
 // N8LOV - Selects a band/frequency from the list
 void selectBand(struct Button *bttn) {
-  /* -RIT
+#if FEATURE_RIT
   // Don't overwrite RIT display, just inhibit this function
   if (!bandSelectOn && ritOn) return;
-  -RIT */
-  while (btnDown() || readTouch())
-    active_delay(100);
-    
+#endif
+  //the button or the touch has already come up by the time a command is run
   toggleBandSelect();
   return; 
 }
+#endif
 
 
 
-int setCwSpeed() {
-  int knob = 0;
-  int wpm;
-
-  wpm = 1200 / cwSpeed;
-
-  wpm = getValueByKnob(1, 100, 1,  wpm, "CW: ", " WPM");
-
+static void cwSpeedDone(int wpm) {
+  //left as it was, the status bar already shows it
+  if (cwSpeed == 1200 / wpm)
+    return;
   cwSpeed = 1200 / wpm;
 
-  EEPROM.put(CW_SPEED, cwSpeed);
-  active_delay(500);
+  eepromPut(CW_SPEED, cwSpeed);
   drawStatusbar();
   //    printLine2("");
   //    updateDisplay();
 }
 
+void setCwSpeed() {
+  getValueByKnob(1, 100, 1,  1200 / cwSpeed, PSTR("CW: "), PSTR(" WPM"), cwSpeedDone);
+}
 
-void setCwTone() {
-  int knob = 0;
-  //int prev_sideTone;
 
-  // N8LOV init display
-  char displayInit = 0;
+static void drawCwTone() {
+  Scratch<20> text;
+  Scratch<7> number;
 
-  while (btnDown()); // N8LOV - wait for button up (for button menu function)
+  tone(CW_TONE, sideTone);
+  itoa(sideTone, number, 10);
+  strcpy_P(text, PSTR("CW Tone: "));
+  strcat(text, number);
+  strcat_P(text, PSTR(" Hz"));
+  drawCommandbar(text);
+  //printLine2(text);
+}
 
-  //disable all clock 1 and clock 2
-  while (digitalRead(PTT) == HIGH && (!btnDown() && !readTouch())) // N8LOV
-  {
-    knob = enc_read();
+static void setCwToneStep() {
+  int knob = 0;
 
-    if (!displayInit) // N8LOV
-      displayInit = 1;
-    else if (knob > 0 && sideTone < 2000)
-      sideTone += 10;
-    else if (knob < 0 && sideTone > 100 )
-      sideTone -= 10;
-    else
-      continue; //don't update the frequency or the display
-
-    tone(CW_TONE, sideTone);
-    itoa(sideTone, c, 10);
-    strcpy(b, "CW Tone: ");
-    strcat(b, c);
-    strcat(b, " Hz");
-    drawCommandbar(b);
-    //printLine2(b);
-
-    checkCAT();
-    active_delay(20);
+  if (!dialogSettled())
+    return;
+
+  if (FastPin<PTT>::read() == LOW || dialogButton() || readTouch()) { // N8LOV
+    noTone(CW_TONE);
+    //save the setting
+    eepromPut(CW_SIDETONE, sideTone);
+
+    clearCommandbar(); // N8LOV
+    //displayFillrect(30,41,280, 32, DISPLAY_NAVY);
+    drawStatusbar();
+    dialogClose();
+    dialogSettle(500);
+    return;
   }
-  noTone(CW_TONE);
-  //save the setting
-  EEPROM.put(CW_SIDETONE, sideTone);
 
-  clearCommandbar(); // N8LOV
-  //displayFillrect(30,41,280, 32, DISPLAY_NAVY);
-  drawStatusbar();
-  //  printLine2("");
-  //  updateDisplay();
+  knob = enc_read();
+  if (knob > 0 && sideTone < 2000)
+    sideTone += 10;
+  else if (knob < 0 && sideTone > 100 )
+    sideTone -= 10;
+  else
+    return; //don't update the frequency or the display
+
+  drawCwTone();
+  dialogPace(20);
+}
+
+void setCwTone() {
+  drawCwTone(); // N8LOV init display
+  dialogOpen(setCwToneStep);
+  dialogSettle(50); // N8LOV - wait for button up (for button menu function)
 }
 
 void doCommand(struct Button *b) {
 
-/* -RIT
-  if (!strcmp(b->text, "RIT"))
+#if FEATURE_RIT
+  if (!strcmp_P(b->text, PSTR("RIT")))
     ritToggle(b);
   else
--RIT */ 
-  if (!strcmp(b->text, "LSB"))
+#endif
+  if (!strcmp_P(b->text, PSTR("LSB")))
     sidebandToggle(b);
-  else if (!strcmp(b->text, "USB"))
+  else if (!strcmp_P(b->text, PSTR("USB")))
     sidebandToggle(b);
-  else if (!strcmp(b->text, "CW"))
+  else if (!strcmp_P(b->text, PSTR("CW")))
     cwToggle(b);
-  else if (!strcmp(b->text, "SPL"))
+  else if (!strcmp_P(b->text, PSTR("SPL")))
     splitToggle(b);
-  else if (!strcmp(b->text, "VFOA")) {
+  else if (!strcmp_P(b->text, PSTR("VFOA"))) {
     if (vfoActive == VFO_A)
       fastTune();
     else
       switchVFO(VFO_A);
   }
-  else if (!strcmp(b->text, "VFOB")) {
+  else if (!strcmp_P(b->text, PSTR("VFOB"))) {
     if (vfoActive == VFO_B)
       fastTune();
     else
       switchVFO(VFO_B);
   }
-  else if (!strcmp(b->text, "SAV"))
+#if FEATURE_UI_EXTRAS
+  else if (!strcmp_P(b->text, PSTR("SAV")))
     saveActiveVFO(b);
-  else if (!strcmp(b->text, "RCL"))
+  else if (!strcmp_P(b->text, PSTR("RCL")))
     recallActiveVFO(b);
-  else if (!strcmp(b->text, "1Kz"))
+  else if (!strcmp_P(b->text, PSTR("1Kz")))
     oneKhzToggle(b);
-  else if (!strcmp(b->text, "A>I"))
+  else if (!strcmp_P(b->text, PSTR("A>I")))
     Act2Inact(b);
-  else if (!strcmp(b->text, "BND"))
+#endif
+#if FEATURE_BAND_SELECT
+  else if (!strcmp_P(b->text, PSTR("BND")))
     selectBand(b);
-  else if (!strcmp(b->text, "FRQ"))
+#endif
+  else if (!strcmp_P(b->text, PSTR("FRQ")))
     enterFreq();
-  else if (!strcmp(b->text, "WPM"))
+  else if (!strcmp_P(b->text, PSTR("WPM")))
     setCwSpeed();
-  else if (!strcmp(b->text, "TON"))
+  else if (!strcmp_P(b->text, PSTR("TON")))
     setCwTone();
 }
 
+static bool touched;
+
 void  checkTouch() {
 
-  if (!readTouch())
+  //a touch is acted upon when the finger lifts, one left over from a dialog is ignored
+  if (readTouch()) {
+    if (!touchHeld)
+      touched = true;
+    return;
+  }
+  touchHeld = false;
+  if (!touched)
     return;
+  touched = false;
 
-  while (readTouch())
-    checkCAT();
   scaleTouch(&ts_point);
 
   /* //debug code
     Serial.print(ts_point.x); Serial.print(' ');Serial.println(ts_point.y);
   */
-  int total = sizeof(btn_set) / sizeof(struct Button);
   for (int i = 0; i < MAX_BUTTONS; i++) {
     struct Button b;
     memcpy_P(&b, btn_set + i, sizeof(struct Button));
@@ -1029,9 +1323,47 @@ void  checkTouch() {
   }
 }
 
+/**
+   The display goes to sleep after DISPLAY_SLEEP_AFTER minutes of nothing happening on the front panel.
+   The turn, press or touch that wakes it up is swallowed, it doesn't tune or pick a command.
+*/
+#if DISPLAY_SLEEP_AFTER
+static bool displayAsleep = false;
+
+bool uiIdle() {
+  bool active = enc_activity() || inTx || dialogStep != NULL;
+
+  if (!displayAsleep) {
+    if (active || touched || !timerRunning(TIMER_IDLE))
+      timerStart(TIMER_IDLE, DISPLAY_SLEEP_AFTER * 60000l);
+    else if (timerExpired(TIMER_IDLE)) {
+      timerStop(TIMER_IDLE);
+      displaySleep();
+      displayAsleep = true;
+    }
+    return displayAsleep;
+  }
+
+  //the touch screen is only polled here while the display is off, checkTouch() does it otherwise
+  if (!active && !readTouch())
+    return true;
+
+  displayWake();
+  displayAsleep = false;
+  enc_read();
+  touchHeld = true;
+  dialogSettle(300);
+  return false;
+}
+#else
+bool uiIdle() {
+  return false;
+}
+#endif
+
 //returns true if the button is pressed
 int btnDown() {
-  if (digitalRead(FBUTTON) == HIGH)
+  if (FastPin<FBUTTON>::read() == HIGH)
     return 0;
   else
     return 1;
@@ -1046,78 +1378,70 @@ void drawFocus(int ibtn, int color) {
 }
 
 
-void doCommands() {
-  int select = 0, i = 0, prevButton = 0, btnState = 0;
-  select = (vfoActive == VFO_A ? 0 : 1);
-  prevButton = select;
-  
-  //wait for the button to be raised up
-  while (btnDown())
-    active_delay(50);
-  active_delay(50);  //debounce
-
-  menuOn = 2;
-
-  while (menuOn) {
-
-    //check if the knob's button was pressed
-    btnState = btnDown();
-    if (btnState) {
-      struct Button b;
-      memcpy_P(&b, btn_set + select, sizeof(struct Button));
-      
-      //wait for the button to be up and debounce
-      while (btnDown())
-        active_delay(100);
-      doCommand(&b);
-
-      //unfocus the buttons
-      drawFocus(select, DISPLAY_NAVY);
-      if (vfoActive == VFO_A)
-        drawFocus(0, DISPLAY_WHITE);
-      else
-        drawFocus(1, DISPLAY_WHITE);
+static int focusButton, prevButton;
+static bool picked;
 
+static void doCommandsStep() {
+  int i = 0;
 
-      active_delay(500);
-      menuOn=0;
-      return;
-    }
+  //the settle holds off until the button is back up and debounced
+  if (!dialogSettled())
+    return;
 
-    i = enc_read();
+  if (picked) {
+    struct Button b;
+    memcpy_P(&b, btn_set + focusButton, sizeof(struct Button));
 
-    if (i == 0) {
-      active_delay(50);
-      continue;
-    }
+    //unfocus the buttons before the command draws over them
+    drawFocus(focusButton, DISPLAY_NAVY);
+    if (vfoActive == VFO_A)
+      drawFocus(0, DISPLAY_WHITE);
+    else
+      drawFocus(1, DISPLAY_WHITE);
 
-    if (i > 0) {
-      if (select + 1 < MAX_BUTTONS)
-        select += 1;
-    }
-    if (i < 0 && select - 1 >= 0)
-      select += -1;      
+    dialogClose();
+    doCommand(&b);
+    return;
+  }
 
-    if (prevButton == select)
-      continue;
+  //check if the knob's button was pressed
+  if (dialogButton()) {
+    picked = true;
+    dialogSettle(100);
+    return;
+  }
 
-    //we are on a new button
-    if (prevButton < 2) // for VFOs
-      drawFocus(prevButton, DISPLAY_NAVY);
-    else
-      drawFocus(prevButton, DISPLAY_DARKGREY);
-    drawFocus(select, DISPLAY_WHITE);
-    prevButton = select;
+  i = enc_read();
+  if (i == 0)
+    return;
 
-    active_delay(100);
+  if (i > 0) {
+    if (focusButton + 1 < MAX_BUTTONS)
+      focusButton += 1;
   }
+  if (i < 0 && focusButton - 1 >= 0)
+    focusButton += -1;      
+
+  if (prevButton == focusButton)
+    return;
 
+  //we are on a new button
+  if (prevButton < 2) // for VFOs
+    drawFocus(prevButton, DISPLAY_NAVY);
+  else
+    drawFocus(prevButton, DISPLAY_DARKGREY);
+  drawFocus(focusButton, DISPLAY_WHITE);
+  prevButton = focusButton;
 
-  //debounce the button
-  while (btnDown())
-    active_delay(50);
-  active_delay(50);
+  dialogPace(100);
+}
 
-  checkCAT();
-  
+void doCommands() {
+  focusButton = (vfoActive == VFO_A ? 0 : 1);
+  prevButton = focusButton;
+  picked = false;
+
+  //wait for the button to be raised up
+  dialogOpen(doCommandsStep);
+  dialogSettle(50);  //debounce
 }
@@ -41,10 +41,20 @@
 #include <EEPROM.h>
 #include "ubitx.h"
 #include "nano_gui.h"
+#include "fastio.h"
+#include "scratch.h"
+#include "trace.h"
 
 // N8LOV - define displayed software version here
 #define CALLSIGN_VER  "v6.1.N8LOV.1"
 
+//name the features of this build in the compiler output when asked to, see config.h
+#if PROFILE_VERBOSE
+#define STR_(x) #x
+#define STR(x) STR_(x)
+#pragma message "profile " STR(UBITX_PROFILE) ": rit " STR(FEATURE_RIT) ", iambic " STR(FEATURE_IAMBIC) ", cat " STR(FEATURE_CAT) ", band select " STR(FEATURE_BAND_SELECT) ", ui extras " STR(FEATURE_UI_EXTRAS)
+#endif
+
 /**
     The main chip which generates upto three oscillators of various frequencies in the
     Raduino is the Si5351a. To learn more about Si5351a you can download the datasheet
@@ -131,12 +141,15 @@
    created in a memory region called the stack. The stack has just a few bytes of space on the Arduino
    if you declare large strings inside functions, they can easily exceed the capacity of the stack
    and mess up your programs.
-   We circumvent this by declaring a few global buffers as  kitchen counters where we can
-   slice and dice our strings. These strings are mostly used to control the display or handle
+   We circumvent this with a small arena where functions lease the bytes to
+   slice and dice our strings, see scratch.h. These strings are mostly used to control the display or handle
    the input and output from the USB port. We must keep a count of the bytes used while reading
    the serial port as we can easily run out of buffer space. This is done in the serial_in_count variable.
 */
-char c[30], b[30];
+//the scratch arena for formatting text, see scratch.h
+char scratchArena[SCRATCH_SIZE];
+byte scratchTop = 0;
+byte scratchOverflows = 0;
 //char printBuff[2][20];  //mirrors what is showing on the two lines of the display
 //int count = 0;          //to generally count ticks, loops, etc
 
@@ -220,17 +233,20 @@ char c[30], b[30];
 //#define TX_SSB 0
 //#define TX_CW 1
 
+#if FEATURE_BAND_SELECT
 bool bandSelectOn = 0;  // N8LOV - band selection mode is off
+#endif
 bool inhibitTx = 0; // N8LOV - default to no inhibit
-/* -RIT
+#if FEATURE_RIT
 bool ritOn = 0;
--RIT */
+uint32_t ritRxFrequency, ritTxFrequency;
+#endif
 char vfoActive = VFO_A;
 //int8_t meter_reading = 0; // a -1 on meter makes it invisible
-unsigned long vfoA = 7150000L, vfoB = 14200000L, sideTone = 800, usbCarrier;
+uint32_t vfoA = 7150000L, vfoB = 14200000L, sideTone = 800, usbCarrier;
 bool isUsbVfoA = false, isUsbVfoB = true;
-unsigned long frequency  /*-RIT , ritRxFrequency, ritTxFrequency -RIT */;  //frequency is the current frequency on the dial
-unsigned long firstIF =   45005000L;
+uint32_t frequency;  //frequency is the current frequency on the dial
+uint32_t firstIF =   45005000L;
 
 // if cwMode is flipped on, the rx frequency is tuned down by sidetone hz instead of being zerobeat
 bool cwMode = false; // the current cw status (of the active VFO)
@@ -254,13 +270,14 @@ bool doingCAT = 0;
 bool txCAT = false;        //turned on if the transmitting due to a CAT command
 bool inTx = false;                //it is set to 1 if in transmit mode (whatever the reason : cw, ptt or cat)
 bool splitOn = false;             //working split, uses VFO B as the transmit frequency
+#if FEATURE_UI_EXTRAS
 bool oneKhzOn = false;            //1 Khz freq adjustment by knob
+#endif
 bool keyDown = false;             //in cw mode, denotes the carrier is being transmitted
 bool isUSB = false;               //upper sideband was selected, this is reset to the default for the
 //frequency when it crosses the frequency border of 10 MHz
 byte menuOn = 0;              //set to 1 when the menu is being displayed, if a menu item sets it to zero, the menu is exited
-unsigned long cwTimeout = 0;  //milliseconds to go before the cw transmit line is released and the radio goes back to rx mode
-unsigned long dbgCount = 0;   //not used now
+uint32_t dbgCount = 0;   //not used now
 unsigned char txFilter = 0;   //which of the four transmit filters are in use
 boolean modeCalibrate = false;//this mode of menus shows extended menus to calibrate the oscillators and choose the proper
 //beat frequency
@@ -275,9 +292,9 @@ boolean modeCalibrate = false;//this mode of menus shows extended menus to calib
 */
 
 void active_delay(int delay_by) {
-  unsigned long timeStart = millis();
-  while (millis() - timeStart <= (unsigned long)delay_by) {
-    delay(10);
+  uint32_t timeStart = millis();
+  while (millis() - timeStart <= (uint32_t)delay_by) {
+    idleSleep();
     //Background Work
     checkCAT();
   }
@@ -318,30 +335,34 @@ void saveVFO() {
   bool b;
   if (vfoActive == VFO_A){
     EEPROM.get(VFO_A, vfoA);
-    if (frequency != vfoA) EEPROM.put(VFO_A, frequency);
+    if (frequency != vfoA) eepromPut(VFO_A, frequency);
 
     EEPROM.get(VFO_A_MODE, x);
-    if (isUSB)
-      if (x != VFO_MODE_USB) EEPROM.put(VFO_A_MODE, VFO_MODE_USB);
-    else
-      if (x != VFO_MODE_LSB) EEPROM.put(VFO_A_MODE, VFO_MODE_LSB);  
+    if (isUSB) {
+      if (x != VFO_MODE_USB) eepromPut(VFO_A_MODE, VFO_MODE_USB);
+    }
+    else {
+      if (x != VFO_MODE_LSB) eepromPut(VFO_A_MODE, VFO_MODE_LSB);  
+    }
 
     EEPROM.get(VFO_A_CW_MODE, b);
-    if (b != cwMode) EEPROM.put(VFO_A_CW_MODE, cwMode);  
+    if (b != cwMode) eepromPut(VFO_A_CW_MODE, cwMode);  
   }
 
   if (vfoActive == VFO_B){
     EEPROM.get(VFO_B, vfoB);
-    if (frequency != vfoB) EEPROM.put(VFO_B, frequency);
+    if (frequency != vfoB) eepromPut(VFO_B, frequency);
 
     EEPROM.get(VFO_B_MODE, x);
-    if (isUSB)
-      if (x != VFO_MODE_USB) EEPROM.put(VFO_B_MODE, VFO_MODE_USB);
-    else
-      if (x != VFO_MODE_LSB) EEPROM.put(VFO_B_MODE, VFO_MODE_LSB);
+    if (isUSB) {
+      if (x != VFO_MODE_USB) eepromPut(VFO_B_MODE, VFO_MODE_USB);
+    }
+    else {
+      if (x != VFO_MODE_LSB) eepromPut(VFO_B_MODE, VFO_MODE_LSB);
+    }
 
     EEPROM.get(VFO_B_CW_MODE, b);
-    if (b != cwMode) EEPROM.put(VFO_B_CW_MODE, cwMode);
+    if (b != cwMode) eepromPut(VFO_B_CW_MODE, cwMode);
   }
 }
 
@@ -388,58 +409,34 @@ void recallVFO() {
    See the circuit to understand this
 */
 
-void setTXFilters(unsigned long freq) {
+void setTXFilters(uint32_t freq) {
 
   if (freq > 21000000L) { // the default filter is with 35 MHz cut-off
-    digitalWrite(TX_LPF_A, 0);
-    digitalWrite(TX_LPF_B, 0);
-    digitalWrite(TX_LPF_C, 0);
+    FastPin<TX_LPF_A>::low();
+    FastPin<TX_LPF_B>::low();
+    FastPin<TX_LPF_C>::low();
   }
   else if (freq >= 14000000L) { //thrown the KT1 relay on, the 30 MHz LPF is bypassed and the 14-18 MHz LPF is allowd to go through
-    digitalWrite(TX_LPF_A, 1);
-    digitalWrite(TX_LPF_B, 0);
-    digitalWrite(TX_LPF_C, 0);
+    FastPin<TX_LPF_A>::high();
+    FastPin<TX_LPF_B>::low();
+    FastPin<TX_LPF_C>::low();
   }
   else if (freq > 7000000L) {
-    digitalWrite(TX_LPF_A, 0);
-    digitalWrite(TX_LPF_B, 1);
-    digitalWrite(TX_LPF_C, 0);
+    FastPin<TX_LPF_A>::low();
+    FastPin<TX_LPF_B>::high();
+    FastPin<TX_LPF_C>::low();
   }
   else {
-    digitalWrite(TX_LPF_A, 0);
-    digitalWrite(TX_LPF_B, 0);
-    digitalWrite(TX_LPF_C, 1);
+    FastPin<TX_LPF_A>::low();
+    FastPin<TX_LPF_B>::low();
+    FastPin<TX_LPF_C>::high();
   }
 }
 
 
-void setTXFilters_v5(unsigned long freq) {
-
-  if (freq > 21000000L) { // the default filter is with 35 MHz cut-off
-    digitalWrite(TX_LPF_A, 0);
-    digitalWrite(TX_LPF_B, 0);
-    digitalWrite(TX_LPF_C, 0);
-  }
-  else if (freq >= 14000000L) { //thrown the KT1 relay on, the 30 MHz LPF is bypassed and the 14-18 MHz LPF is allowd to go through
-    digitalWrite(TX_LPF_A, 1);
-    digitalWrite(TX_LPF_B, 0);
-    digitalWrite(TX_LPF_C, 0);
-  }
-  else if (freq > 7000000L) {
-    digitalWrite(TX_LPF_A, 0);
-    digitalWrite(TX_LPF_B, 1);
-    digitalWrite(TX_LPF_C, 0);
-  }
-  else {
-    digitalWrite(TX_LPF_A, 0);
-    digitalWrite(TX_LPF_B, 0);
-    digitalWrite(TX_LPF_C, 1);
-  }
-}
-
 // N8LOV
 // sets inhibitTx based on transmit frequency compared to transmit frequency bounds
-void checkTxFreq(unsigned long f) {
+void checkTxFreq(uint32_t f) {
   inhibitTx = ((f > HIGHEST_TX_FREQ || f < LOWEST_TX_FREQ) ? 1 : 0);
 }
 
@@ -456,8 +453,13 @@ void checkTxFreq(unsigned long f) {
    through mixing of the second local oscillator.
 */
 
-void setFrequency(unsigned long f) {
-  uint64_t osc_f, firstOscillator, secondOscillator;
+void setFrequency(uint32_t f) {
+  //startTx() checks the bounds, but CAT can still retune while we transmit: stay where we
+  //are, out of the bands the transmitter must not go. The PTT or the key ends the transmit
+  if (inTx && (f > HIGHEST_TX_FREQ || f < LOWEST_TX_FREQ)) {
+    trace(TRACE_TX_BOUNDS, 0, f / 1000);
+    return;
+  }
 
   setTXFilters(f);
 
@@ -497,6 +499,8 @@ void setFrequency(unsigned long f) {
   si5351bx_setfreq(1, firstIF + (isUSB ? -usbCarrier : usbCarrier));
 
   frequency = f;
+  bcdTune(f);
+  trace(TRACE_FREQ, (isUSB ? TRACE_FLAG_USB : 0) | (cwMode ? TRACE_FLAG_CW : 0) | (inTx ? TRACE_FLAG_TX : 0), f / 1000);
 }
 
 /**
@@ -510,11 +514,11 @@ void startTx(byte txMode) {
   //unsigned long tx_freq = 0;
 
   // N8LOV - check Tx frequency bounds first, return if Tx freq is out of bounds
-/* -RIT
+#if FEATURE_RIT
   if (ritOn) {
     checkTxFreq(ritTxFrequency);
   } else 
--RIT */
+#endif
   
   if (splitOn) {
     if (vfoActive == VFO_B) {
@@ -527,10 +531,10 @@ void startTx(byte txMode) {
   }
   if (inhibitTx) return;
 
-  digitalWrite(TX_RX, 1);
+  trace(TRACE_TX_START, txMode, frequency / 1000);
   inTx = 1;
 
-/* -RIT
+#if FEATURE_RIT
   if (ritOn) {
     //save the current as the rx frequency
     ritRxFrequency = frequency;
@@ -538,7 +542,7 @@ void startTx(byte txMode) {
   }
   else
   {
--RIT */  
+#endif
     if (splitOn == 1) {
       if (vfoActive == VFO_B) {
         vfoActive = VFO_A;
@@ -552,12 +556,14 @@ void startTx(byte txMode) {
       }
     }
     setFrequency(frequency);
-/* -RIT    
+#if FEATURE_RIT
   }
--RIT */  
+#endif
+  //only now, with split or RIT the oscillators and the filters were still on the rx frequency
+  FastPin<TX_RX>::high();
 
   if (txMode == TX_CW) {
-    digitalWrite(TX_RX, 0);
+    FastPin<TX_RX>::low();
 
     //turn off the second local oscillator and the bfo
     si5351bx_setfreq(0, 0);
@@ -567,23 +573,31 @@ void startTx(byte txMode) {
     si5351bx_setfreq(2, frequency);
 
     delay(20);
-    digitalWrite(TX_RX, 1);
+    FastPin<TX_RX>::high();
   }
   drawTx();
 
 }
 
 void stopTx() {
+  //the keyer's hang time can run out after CAT has ended the transmit, the vfos would swap twice
+  if (!inTx)
+    return;
+  trace(TRACE_TX_STOP, 0, 0);
   inTx = false;
 
-  digitalWrite(TX_RX, 0);           //turn off the tx
+  //CAT can end it in the middle of a CW element, the carrier goes with it
+  keyDown = false;
+  noTone(CW_TONE);
+  FastPin<CW_KEY>::low();
+  FastPin<TX_RX>::low();           //turn off the tx
   si5351bx_setfreq(0, usbCarrier);  //set back the carrier oscillator anyway, cw tx switches it off
 
-/* -RIT
+#if FEATURE_RIT
   if (ritOn)
     setFrequency(ritRxFrequency);
   else {
--RIT  */
+#endif
     if (splitOn) {
       //vfo Change
       if (vfoActive == VFO_B) {
@@ -598,9 +612,9 @@ void stopTx() {
       }
     }
     setFrequency(frequency);
-/* -RIT    
+#if FEATURE_RIT
   }
--RIT  */
+#endif
   //updateDisplay();
   drawTx();
 }
@@ -609,8 +623,8 @@ void stopTx() {
    ritEnable is called with a frequency parameter that determines
    what the tx frequency will be
 */
-/* -RIT
-void ritEnable(unsigned long f) {
+#if FEATURE_RIT
+void ritEnable(uint32_t f) {
   ritOn = 1;
   //save the non-rit frequency back into the VFO memory
   //as RIT is a temporary shift, this is not saved to EEPROM
@@ -625,7 +639,7 @@ void ritDisable() {
     updateDisplay();
   }
 }
--RIT */
+#endif
 
 /**
    Basic User Interface Routines. These check the front panel for any activity
@@ -639,49 +653,49 @@ void ritDisable() {
 
 void checkPTT() {
   //we don't check for ptt when transmitting cw
-  if (cwTimeout > 0)
+  if (timerRunning(TIMER_CW))
     return;
 
-  if (digitalRead(PTT) == 0 && !inTx) {
+  if (FastPin<PTT>::read() == 0 && !inTx) {
     startTx(TX_SSB);
     active_delay(50); //debounce the PTT
   }
 
-  if (digitalRead(PTT) == 1 && inTx)
+  if (FastPin<PTT>::read() == 1 && inTx)
     stopTx();
 }
 
-//check if the encoder button was pressed
-void checkButton() {
-  int i, t1, t2, knob, new_knob;
+//check if the encoder button was pressed, a short press brings up the commands, a long one the setup
+static bool buttonPressed = false;
+static uint32_t buttonPressedAt;
 
-  //only if the button is pressed
-  if (!btnDown())
-    return;
-  active_delay(50);
-  if (!btnDown()) //debounce
+void checkButton() {
+  //a dialog that just closed may still be waiting for the button to come up
+  if (!dialogSettled())
     return;
-  
-  //disengage any CAT work
-  doingCAT = 0;
 
-  int downTime = 0;
-  while (btnDown()) {
-    active_delay(10);
-    downTime++;
-    if (downTime > 300) {
+  if (dialogButton()) {
+    if (!buttonPressed) {
+      buttonPressed = true;
+      buttonPressedAt = ticks();
+    }
+    else if (ticks() - buttonPressedAt > 3000) {
+      buttonPressed = false;
       doSetup2();
-      return;
     }
+    return;
   }
-  active_delay(100);
 
+  //only act when the button comes up
+  if (!buttonPressed)
+    return;
+  buttonPressed = false;
+  if (ticks() - buttonPressedAt < 50) //debounce
+    return;
 
+  //disengage any CAT work
+  doingCAT = 0;
   doCommands();
-  //wait for the button to go up again
-  while (btnDown())
-    active_delay(10);
-  active_delay(50);//debounce
 }
 
 void switchVFO(int vfoSelect) {
@@ -725,17 +739,20 @@ void switchVFO(int vfoSelect) {
 
 void doTuning() {
   int s;
-  static unsigned long prev_freq;
-  static unsigned long nextFrequencyUpdate = 0;
+  static uint32_t prev_freq;
 
-  unsigned long now = millis();
+  //a stale deadline is dropped, it would read as being in the future again after 25 days
+  if (timerExpired(TIMER_DISPLAY))
+    timerStop(TIMER_DISPLAY);
 
-  if (now >= nextFrequencyUpdate && prev_freq != frequency) {
+  if (!timerRunning(TIMER_DISPLAY) && prev_freq != frequency) {
     updateDisplay();
-    nextFrequencyUpdate = now + 500;
+    diagKnobShown();
+    timerStart(TIMER_DISPLAY, 500);
     prev_freq = frequency;
   }
 
+  diagStepTime(stepAt);
   s = enc_read();
   if (!s)
     return;
@@ -766,18 +783,19 @@ void doTuning() {
   if (frequency < LOWEST_FREQ) frequency = LOWEST_FREQ;
 
   setFrequency(frequency);
+  diagKnobTuned(stepAt);
 }
 
 
 /**
    RIT only steps back and forth by 100 hz at a time
 */
-/* -RIT
+#if FEATURE_RIT
 void doRIT() {
-  unsigned long newFreq;
+  uint32_t newFreq;
 
   int knob = enc_read();
-  unsigned long old_freq = frequency;
+  uint32_t old_freq = frequency;
 
   if (knob < 0)
     frequency -= 100l;
@@ -789,7 +807,7 @@ void doRIT() {
     updateDisplay();
   }
 }
--RIT */
+#endif
 
 /**
    The settings are read from EEPROM. The first time around, the values may not be
@@ -895,32 +913,87 @@ void initPorts() {
   digitalWrite(CW_KEY, 0);
 }
 
+/**
+   Set BOOT_PROFILE to 1 to time the start up. The time each stage ends is taken with micros()
+   and, when the screen is complete, the list is printed on the serial port at 38400 baud.
+   It prints plain text on the CAT port, so leave it at 0 in a build that talks to a logging program.
+*/
+#define BOOT_PROFILE 0
+
+#define BOOT_DISPLAY      0 // the display controller is set up and leaving its sleep mode
+#define BOOT_SETTINGS     1 // the EEPROM has been read
+#define BOOT_PORTS        2
+#define BOOT_RX           3 // the oscillators are on the vfo frequency, the radio receives
+#define BOOT_DISPLAY_ON   4
+#define BOOT_FIRST_PAINT  5 // the vfos are on the screen
+#define BOOT_UI           6 // the buttons and the status bar are on the screen
+#define BOOT_STAGES       7
+
+#if BOOT_PROFILE
+static uint32_t bootStamps[BOOT_STAGES];
+#define bootStamp(stage) (bootStamps[stage] = micros())
+
+const char bootStageNames[BOOT_STAGES][12] PROGMEM = {
+  "display", "settings", "ports", "first rx", "display on", "first paint", "ui"
+};
+
+static void bootReport() {
+  for (byte i = 0; i < BOOT_STAGES; i++) {
+    Serial.print((const __FlashStringHelper *)bootStageNames[i]);
+    Serial.print(F(": "));
+    Serial.print(bootStamps[i]);
+    Serial.println(F(" usec"));
+  }
+}
+#else
+#define bootStamp(stage)
+#define bootReport()
+#endif
+
+/**
+   The display controller needs 120 msec after its sleep-out before it can be switched on.
+   Instead of waiting for it, the settings, the ports and the oscillators are set up in that
+   time, so the radio is receiving before anything is on the screen. Then the vfos are painted
+   and loop() paints the rest of the screen a piece at a time while the radio is already in use.
+*/
 void setup()
 {
+#if DIAG_STACK
+  stackPaint();
+#endif
   Serial.begin(38400);
   Serial.flush();
 
   displayInit();
+  bootStamp(BOOT_DISPLAY);
   initSettings();
+  bootStamp(BOOT_SETTINGS);
   initPorts();
+  bootStamp(BOOT_PORTS);
   initOscillators();
   frequency = vfoA;
   setFrequency(vfoA);
+  bootStamp(BOOT_RX);
   enc_setup();
+  tick_setup();
+  displayStart();
+  bootStamp(BOOT_DISPLAY_ON);
+
+#if BENCHMARKS
+  runBenchmarks();
+  setFrequency(frequency);
+#endif
 
-  if (btnDown()) {
-    setupTouch();
-    isUSB = true;
-    setFrequency(10000000l);
-    setupFreq();
-    isUSB = false;
-    setFrequency(7100000l);
-    setupBFO();
+  //the calibration dialogs run from loop() and bring up the main screen when they are done
+  if (btnDown())
+    setupCalibrate();
+  else {
+    guiPaintVFOs();
+    //displayRawText("v6.1", 160, 210, DISPLAY_LIGHTGREY, DISPLAY_NAVY);
+    // N8LOV - use #define for software version. display in commandbar area at startup
+    displayText(F(CALLSIGN_VER), CMDBAR_X, ROW2_Y, FULL_W, BTN_H, DISPLAY_LIGHTGREY, DISPLAY_NAVY, DISPLAY_NAVY);
+    bootStamp(BOOT_FIRST_PAINT);
   }
-  guiUpdate();
-  //displayRawText("v6.1", 160, 210, DISPLAY_LIGHTGREY, DISPLAY_NAVY);
-  // N8LOV - use #define for software version. display in commandbar area at startup
-  displayText(CALLSIGN_VER, CMDBAR_X, ROW2_Y, FULL_W, BTN_H, DISPLAY_LIGHTGREY, DISPLAY_NAVY, DISPLAY_NAVY);
 }
 
 
@@ -930,23 +1003,61 @@ void setup()
 */
 
 void loop() {
+  //the stages are timed only when DIAG_HISTOGRAMS is set, see diag.cpp
+  diagBegin(pass);
+  diagBegin(lap);
+
+  //no keying from inside a menu or a dialog, those that take the PTT close on it first. A
+  //transmit that is already on is still ended
+  if (!dialogStep || inTx) {
+    if (cwMode) {
+      cwKeyer();
+      diagLap(DIAG_KEYER, lap);
+    }
+    else if (!txCAT) {
+      checkPTT();
+      diagLap(DIAG_PTT, lap);
+    }
+  }
 
-  if (cwMode)
-    cwKeyer();
-  else if (!txCAT)
-    checkPTT();
-
-  checkButton();
-  //tune only when not tranmsitting
-  if (!inTx) {
-/* -RIT    
-    if (ritOn)
-      doRIT();
-    else
--RIT */
-      doTuning();
-    checkTouch();
-  } else if (bandSelectOn) toggleBandSelect(); // N8LOV - cancel band select in transmit
+  bool asleep = uiIdle();
+  diagRestart(lap);
+
+  //an open menu or dialog takes the knob, the button and the touch screen
+  if (dialogStep) {
+    if (!inTx)
+      dialogStep();
+    diagLap(DIAG_SCREEN, lap);
+  }
+  else if (!asleep) {
+    //the rest of the screen left over from setup()
+    if (guiPaintStep()) {
+      bootStamp(BOOT_UI);
+      bootReport();
+    }
+    diagLap(DIAG_SCREEN, lap);
+    checkButton();
+    diagLap(DIAG_BUTTON, lap);
+    //tune only when not tranmsitting
+    if (!inTx) {
+#if FEATURE_RIT
+      if (ritOn)
+        doRIT();
+      else
+#endif
+        doTuning();
+      diagLap(DIAG_TUNING, lap);
+      checkTouch();
+      diagLap(DIAG_TOUCH, lap);
+    } else if (bandSelectOn) toggleBandSelect(); // N8LOV - cancel band select in transmit
+  }
 
+  diagRestart(lap);
   checkCAT();
+  diagLap(DIAG_CAT, lap);
+  diagLap(DIAG_LOOP, pass);
+
+  //rest until the next tick or event instead of spinning, the busy loop could be heard in the receiver
+  if (!inTx)
+    idleSleep();
 }